@@ -9,13 +9,53 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
 #include <util/delay.h>
 
 #define ADCSRA_PRESCALE_MASK   0b00000111
 #define ADMUX_REFERENCE_MASK   0b11000000
 #define ADMUX_MUX_MASK         0b00011111
-#define ADCSRB_MUX5_MASK       0b00100000
-#define ADCSRA_ADTS_MASK       0b00000111
+#define ADCSRB_MUX5_MASK       0b00001000
+#define ADCSRB_ADTS_MASK       0b00000111
+
+#define ADTS_FREE_RUNNING      0x00 // See Atmega640 documentation table 26-6
+#define ADTS_TIMER0_COMPA      0x03
+
+#define A2D_MAX_OVERSAMPLE     3    // 4^3 10-bit results fit in the 16-bit sum
+
+// Interrupt handler modes
+enum EMode { MODE_NONE, MODE_SCAN, MODE_SAMPLE, MODE_FAST, MODE_QUIET };
+
+static volatile uint8_t a2d_mode = MODE_NONE;
+
+// Scan state
+static const A2D::ScanEntry* a2d_scanSequence;
+static CRingBuffer<A2D::Sample>* a2d_scanBuffer;
+static uint8_t a2d_scanCount;
+static uint8_t a2d_scanIndex;
+static bool a2d_scanContinuous;
+static bool a2d_scanDiscard;
+
+// Fixed-rate sampling state
+static CRingBuffer<uint16_t>* a2d_sampleBuffer;
+static uint8_t a2d_sampleOversample;
+
+// Fast sampling state
+static CRingBuffer<uint8_t>* a2d_fastBuffer;
+static uint8_t a2d_fastPrevPrescale;
+
+// Noise reduction conversion state
+static volatile bool a2d_quietDone;
+
+// Oversampling state
+static uint16_t a2d_oversampleSum;
+static uint8_t a2d_oversampleCount;
+static volatile uint8_t* a2d_ditherPin;
+static uint8_t a2d_ditherMask;
+
+// Timer 0 prescaling factors, indexed by clock select bits
+static const uint16_t a2d_timer0Prescalers[] PROGMEM = {0, 1, 8, 64, 256, 1024};
 
 // See Atmega640 documentation chapter 26.8.1 and 26.8.2 and table 26-4 
 static inline void _a2dSetChannel(uint8_t ch)
@@ -28,6 +68,205 @@ static inline void _a2dSetChannel(uint8_t ch)
 	ADMUX = (ADMUX & ~ADMUX_MUX_MASK) | (ch & ADMUX_MUX_MASK);
 }
 
+// Returns the currently selected channel
+static inline uint8_t _a2dChannel()
+{
+	return (ADMUX & ADMUX_MUX_MASK) | ((ADCSRB & ADCSRB_MUX5_MASK) ? 0x20 : 0x00);
+}
+
+// Returns the gain stage used by a channel: 0 = single-ended, 1 = 1x, 2 = 10x, 3 = 200x
+// See Atmega640 documentation table 26-4
+static inline uint8_t _a2dGain(uint8_t ch)
+{
+	ch &= ADMUX_MUX_MASK;
+	if(ch < 0x08 || ch >= 0x1E){
+		return 0;
+	}else if(ch < 0x10){
+		return (ch & 0x02) ? 3 : 2;
+	}
+	return 1;
+}
+
+// The result is a 10bit signed integer for differential channels: need to sign-extend it to 16-bits
+static inline uint16_t _a2dResult(uint8_t ch)
+{
+	uint16_t i = ADC;
+	if(_a2dGain(ch) != 0 && (i & 0x200)){
+		i |= 0xFC00;
+	}
+	return i;
+}
+
+// Selects a differential channel, waits for the gain stage to settle if the
+// channel changed and discards the first conversion if the gain changed
+static void _a2dSelectDiff(uint8_t ch)
+{
+	uint8_t prev = _a2dChannel();
+	if(prev == ch){
+		return;
+	}
+	_a2dSetChannel(ch);
+	_delay_us(125);                  // See Atmega640 documentation chapter 26.5
+	if(_a2dGain(prev) != _a2dGain(ch)){
+		sbi(ADCSRA, ADSC);
+		while(bit_is_set(ADCSRA, ADSC));
+	}
+}
+
+// Converts the selected channel
+static inline uint16_t _a2dConvert(uint8_t ch)
+{
+	sbi(ADCSRA, ADSC);               // Start conversion
+	while(bit_is_set(ADCSRA, ADSC)); // Wait until conversion done
+	return _a2dResult(ch);
+}
+
+// Converts the selected channel in ADC noise reduction sleep mode
+static uint16_t _a2dConvertQuiet(uint8_t ch)
+{
+	uint8_t smcr = SMCR;
+	uint8_t adcsra = ADCSRA;
+	a2d_quietDone = false;
+	a2d_mode = MODE_QUIET;
+	sbi(ADCSRA, ADIF);
+	sbi(ADCSRA, ADIE);
+	set_sleep_mode(SLEEP_MODE_ADC);
+	disable_interrupts;
+	sleep_enable();
+	// Entering the sleep mode starts the conversion
+	while(!a2d_quietDone){
+		sei();       // The instruction following sei is executed before any pending interrupt
+		sleep_cpu();
+		cli();
+	}
+	sleep_disable();
+	a2d_mode = MODE_NONE;
+	SMCR = smcr;
+	if((adcsra & _BV(ADIE)) == 0){
+		cbi(ADCSRA, ADIE);
+	}
+	restore_interrupts;
+	return _a2dResult(ch);
+}
+
+// Offset calibration state, one entry per same-pin differential channel
+#define A2D_OFFSET_CHANNELS 12
+static int16_t a2d_offsets[A2D_OFFSET_CHANNELS];
+static uint8_t a2d_offsetAge[A2D_OFFSET_CHANNELS];
+static uint8_t a2d_offsetInterval = 100;
+
+// Returns the same-pin channel which measures the offset of the gain stage
+// used by a differential channel, see Atmega640 documentation table 26-4
+static inline uint8_t _a2dOffsetChannel(uint8_t ch)
+{
+	uint8_t code = ch & ADMUX_MUX_MASK;
+	uint8_t high = ch & 0x20;
+	if(code < 0x10){
+		return high | (code & ~0x01); // 0_0/2_2 (10x, 200x)
+	}else if(code < 0x18){
+		return high | 0x11;           // 1_1 (1x)
+	}
+	return high | 0x1A;               // 2_2 (1x)
+}
+
+// Returns the index in the offset table of a same-pin channel
+static inline uint8_t _a2dOffsetIndex(uint8_t offsetCh)
+{
+	uint8_t code = offsetCh & ADMUX_MUX_MASK;
+	uint8_t index = code < 0x10 ? (code - 0x08) >> 1 : code == 0x11 ? 4 : 5;
+	return (offsetCh & 0x20) ? index + 6 : index;
+}
+
+// Accumulates an oversampled conversion result
+// Returns true and the decimated result once 4^n results were accumulated
+static inline bool _a2dOversample(uint16_t& value, uint8_t n, bool isSigned)
+{
+	// 4^3 10-bit results fit in 16 bits, both unsigned and signed
+	if(n > A2D_MAX_OVERSAMPLE){
+		n = A2D_MAX_OVERSAMPLE;
+	}
+	a2d_oversampleSum += value;
+	if(++a2d_oversampleCount < (1 << (2*n))){
+		return false;
+	}
+	value = isSigned ? uint16_t(int16_t(a2d_oversampleSum) >> n) : a2d_oversampleSum >> n;
+	a2d_oversampleSum = 0;
+	a2d_oversampleCount = 0;
+	return true;
+}
+
+static inline void _a2dDither()
+{
+	if(a2d_ditherPin != 0){
+		*a2d_ditherPin = a2d_ditherMask;
+	}
+}
+
+// Selects the channel and reference of a scan entry and starts the conversion
+static inline void _a2dScanStart(uint8_t index)
+{
+	const A2D::ScanEntry& entry = a2d_scanSequence[index];
+	uint8_t admux = ADMUX;
+	uint8_t prev = _a2dChannel();
+	// The first conversion after a reference or gain change is inaccurate
+	a2d_scanDiscard = (admux & ADMUX_REFERENCE_MASK) != entry.reference || _a2dGain(prev) != _a2dGain(entry.channel);
+	ADMUX = (admux & ~ADMUX_REFERENCE_MASK) | entry.reference;
+	_a2dSetChannel(entry.channel);
+	if(entry.oversample != 0){
+		_a2dDither();
+	}
+	sbi(ADCSRA, ADSC);
+}
+
+static inline void _a2dScanService()
+{
+	uint8_t index = a2d_scanIndex;
+	if(a2d_scanDiscard){
+		// Repeat the conversion, the mux and reference are already set
+		a2d_scanDiscard = false;
+		sbi(ADCSRA, ADSC);
+		return;
+	}
+	const A2D::ScanEntry& entry = a2d_scanSequence[index];
+	A2D::Sample sample;
+	sample.channel = entry.channel;
+	sample.value = _a2dResult(entry.channel);
+	if(entry.oversample != 0 && !_a2dOversample(sample.value, entry.oversample, _a2dGain(entry.channel) != 0)){
+		// Convert the same channel again
+		_a2dDither();
+		sbi(ADCSRA, ADSC);
+		return;
+	}
+	a2d_scanBuffer->push(sample);
+	if(++index == a2d_scanCount){
+		index = 0;
+		if(!a2d_scanContinuous){
+			a2d_mode = MODE_NONE;
+			cbi(ADCSRA, ADIE);
+			return;
+		}
+	}
+	a2d_scanIndex = index;
+	_a2dScanStart(index);
+}
+
+// Stops the active interrupt handler mode and releases its resources
+static void _a2dStop()
+{
+	cbi(ADCSRA, ADIE);
+	cbi(ADCSRA, ADATE);
+	if(a2d_mode == MODE_SAMPLE){
+		TCCR0B = 0x00;
+		TCCR0A = 0x00;
+		ADCSRB &= ~ADCSRB_ADTS_MASK;
+	}else if(a2d_mode == MODE_FAST){
+		cbi(ADMUX, ADLAR);
+		ADCSRA = (ADCSRA & ~ADCSRA_PRESCALE_MASK) | a2d_fastPrevPrescale;
+	}
+	a2d_mode = MODE_NONE;
+	while(bit_is_set(ADCSRA, ADSC)); // Wait until current conversion done
+}
+
 // Initialize A2D converter
 void A2D::init(EPrescale prescale, EReference reference)
 {
@@ -65,14 +304,69 @@ uint16_t A2D::convert10bit(EChannel ch)
 }
 
 int16_t A2D::convertDiff10bit(EDiffChannel ch)
+{
+	_a2dSelectDiff(ch);
+	return _a2dConvert(ch);
+}
+
+void A2D::startConversion(uint8_t ch)
 {
 	_a2dSetChannel(ch);
-	_delay_us(125);                  // See Atmega640 documentation chapter 26.5
 	sbi(ADCSRA, ADSC);               // Start conversion
-	while(bit_is_set(ADCSRA, ADSC)); // Wait until conversion done
-	// The result is a 10bit signed integer: need to sign-extend it to 16-bits
-	int16_t i = *reinterpret_cast<volatile int16_t*>(&ADC);
-	return (i & 0x200) ? (i | 0xFC00) : i;
+}
+
+uint16_t A2D::conversionResult()
+{
+	return _a2dResult(_a2dChannel());
+}
+
+uint16_t A2D::convertQuiet10bit(EChannel ch)
+{
+	_a2dSetChannel(ch);
+	return _a2dConvertQuiet(ch);
+}
+
+int16_t A2D::convertDiffQuiet10bit(EDiffChannel ch)
+{
+	_a2dSelectDiff(ch);
+	return _a2dConvertQuiet(ch);
+}
+
+int16_t A2D::convertDiff(EDiffChannel ch)
+{
+	uint8_t offsetCh = _a2dOffsetChannel(ch);
+	uint8_t index = _a2dOffsetIndex(offsetCh);
+	if(a2d_offsetAge[index] == 0 || (a2d_offsetInterval != 0 && a2d_offsetAge[index] > a2d_offsetInterval)){
+		calibrateDiff(EDiffChannel(offsetCh));
+	}
+	if(a2d_offsetAge[index] != 0xFF){
+		++a2d_offsetAge[index];
+	}
+	_a2dSelectDiff(ch);
+	return int16_t(_a2dConvert(ch)) - a2d_offsets[index];
+}
+
+void A2D::calibrateDiff(EDiffChannel ch)
+{
+	uint8_t offsetCh = _a2dOffsetChannel(ch);
+	uint8_t index = _a2dOffsetIndex(offsetCh);
+	_a2dSelectDiff(offsetCh);
+	int16_t sum = 0;
+	for(uint8_t i = 0; i < 4; ++i){
+		sum += int16_t(_a2dConvert(offsetCh));
+	}
+	a2d_offsets[index] = (sum + 2) >> 2;
+	a2d_offsetAge[index] = 1;
+}
+
+int16_t A2D::diffOffset(EDiffChannel ch)
+{
+	return a2d_offsets[_a2dOffsetIndex(_a2dOffsetChannel(ch))];
+}
+
+void A2D::setDiffCalibrationInterval(uint8_t interval)
+{
+	a2d_offsetInterval = interval;
 }
 
 void A2D::disableDigitalInput(EChannel ch)
@@ -92,3 +386,151 @@ void A2D::enableDigitalInput(EChannel ch)
 		DIDR1 |= ch;
 	}
 }
+
+void A2D::enableDither(sfr8_t pin, uint8_t bit)
+{
+	disable_interrupts;
+	a2d_ditherPin = &pin;
+	a2d_ditherMask = _BV(bit);
+	restore_interrupts;
+}
+
+void A2D::disableDither()
+{
+	a2d_ditherPin = 0;
+}
+
+void A2D::startScan(const ScanEntry* sequence, uint8_t count, CRingBuffer<Sample>& buffer, bool continuous)
+{
+	_a2dStop();
+	if(count == 0){
+		return;
+	}
+	a2d_scanSequence = sequence;
+	a2d_scanCount = count;
+	a2d_scanBuffer = &buffer;
+	a2d_scanContinuous = continuous;
+	a2d_scanIndex = 0;
+	a2d_oversampleSum = 0;
+	a2d_oversampleCount = 0;
+	a2d_mode = MODE_SCAN;
+	sbi(ADCSRA, ADIF);               // Clear pending interrupt flag
+	sbi(ADCSRA, ADIE);               // Enable conversion complete interrupt
+	sei();
+	_a2dScanStart(0);
+}
+
+void A2D::stopScan()
+{
+	if(a2d_mode == MODE_SCAN){
+		_a2dStop();
+	}
+}
+
+bool A2D::scanActive()
+{
+	return a2d_mode == MODE_SCAN;
+}
+
+uint32_t A2D::startSampling(EChannel ch, uint32_t rate, CRingBuffer<uint16_t>& buffer, uint8_t oversample)
+{
+	if(rate == 0 || oversample > A2D_MAX_OVERSAMPLE){
+		return 0;
+	}
+	rate <<= 2*oversample;
+	// Pick the smallest prescaler for which the compare value fits in 8 bits
+	uint8_t cs = 1;
+	uint32_t top = (F_CPU + rate/2)/rate;
+	while(top > 256 && cs < 5){
+		++cs;
+		top = (F_CPU/pgm_read_word(&a2d_timer0Prescalers[cs]) + rate/2)/rate;
+	}
+	// Slower than F_CPU/1024/256 or faster than F_CPU
+	if(top > 256 || top < 1){
+		return 0;
+	}
+
+	_a2dStop();
+	a2d_sampleOversample = oversample;
+	a2d_oversampleSum = 0;
+	a2d_oversampleCount = 0;
+	a2d_sampleBuffer = &buffer;
+	a2d_mode = MODE_SAMPLE;
+	_a2dSetChannel(ch);
+
+	// Timer 0 in CTC mode, TOP = OCR0A (See table 16-8)
+	TCCR0B = 0x00;
+	TCNT0 = 0;
+	TCCR0A = _BV(WGM01);
+	OCR0A = top - 1;
+	TIFR0 = _BV(OCF0A);
+
+	// Auto-trigger on timer 0 compare match A
+	ADCSRB = (ADCSRB & ~ADCSRB_ADTS_MASK) | ADTS_TIMER0_COMPA;
+	sbi(ADCSRA, ADIF);
+	sbi(ADCSRA, ADIE);
+	sbi(ADCSRA, ADATE);
+	sei();
+
+	TCCR0B = cs; // Start timer
+	return (F_CPU/(pgm_read_word(&a2d_timer0Prescalers[cs])*top)) >> (2*oversample);
+}
+
+void A2D::stopSampling()
+{
+	if(a2d_mode == MODE_SAMPLE){
+		_a2dStop();
+	}
+}
+
+uint32_t A2D::startFastSampling(EChannel ch, EPrescale prescale, CRingBuffer<uint8_t>& buffer)
+{
+	_a2dStop();
+	a2d_fastBuffer = &buffer;
+	a2d_fastPrevPrescale = ADCSRA & ADCSRA_PRESCALE_MASK;
+	a2d_mode = MODE_FAST;
+	_a2dSetChannel(ch);
+	sbi(ADMUX, ADLAR);              // Left-adjusted result: ADCH holds the 8 MSBs
+	setPrescaler(prescale);
+	ADCSRB = (ADCSRB & ~ADCSRB_ADTS_MASK) | ADTS_FREE_RUNNING;
+	sbi(ADCSRA, ADIF);
+	sbi(ADCSRA, ADIE);
+	sbi(ADCSRA, ADATE);
+	sei();
+	sbi(ADCSRA, ADSC);              // Start the first conversion, the others follow automatically
+	return F_CPU/((uint16_t(1) << prescale)*13UL);
+}
+
+void A2D::stopFastSampling()
+{
+	if(a2d_mode == MODE_FAST){
+		_a2dStop();
+	}
+}
+
+ISR(ADC_vect)
+{
+	switch(a2d_mode){
+	case MODE_FAST:
+		a2d_fastBuffer->push(uint8_t(ADCH));
+		break;
+	case MODE_SAMPLE:
+		TIFR0 = _BV(OCF0A); // The trigger is the rising edge of the flag: clear it
+		if(a2d_sampleOversample == 0){
+			a2d_sampleBuffer->push(uint16_t(ADC));
+		}else{
+			uint16_t value = ADC;
+			_a2dDither();
+			if(_a2dOversample(value, a2d_sampleOversample, false)){
+				a2d_sampleBuffer->push(value);
+			}
+		}
+		break;
+	case MODE_SCAN:
+		_a2dScanService();
+		break;
+	case MODE_QUIET:
+		a2d_quietDone = true;
+		break;
+	}
+}
@@ -9,6 +9,7 @@
 #define A2D_HPP
 
 #include <common.hpp>
+#include "ringbuffer.hpp"
 
 namespace A2D {
 /** A2D clock prescalers
@@ -128,11 +129,83 @@ uint16_t convert10bit(EChannel ch);
 /** Performs conversion on specified differential channel
  *  - The result of the conversion is
  *     1024*(V_IN/V_REF)
+ *  - The 125 us settling time of the gain stage is only waited if the
+ *    channel differs from the previously converted channel
  * @param ch A differential A2D channel, @see EDiffChannel
  * @return Converted value in 10-bit precision
  */
 int16_t convertDiff10bit(EDiffChannel ch);
 
+/** Performs offset-corrected conversion on specified differential channel
+ *  The offset of the gain stage is measured on the corresponding same-pin
+ *  channel (i.e. CH_0_0_DIFF10X for CH_1_0_DIFF10X, CH_1_1_DIFF1X for
+ *  CH_4_1_DIFF1X) the first time the gain stage is used and then every
+ *  interval conversions, @see setDiffCalibrationInterval, and subtracted
+ *  from the result.
+ *  - The settling time is only waited if the channel changes, consecutive
+ *    conversions of the same channel are not delayed
+ * @param ch A differential A2D channel, @see EDiffChannel
+ * @return Converted and offset-corrected value in 10-bit precision
+ */
+int16_t convertDiff(EDiffChannel ch);
+
+/** Measures the offset of the gain stage used by a differential channel
+ *  The offset is averaged over four conversions of the same-pin channel.
+ * @param ch A differential A2D channel, @see EDiffChannel
+ */
+void calibrateDiff(EDiffChannel ch);
+
+/** Returns the last measured offset of the gain stage used by a differential channel
+ * @param ch A differential A2D channel, @see EDiffChannel
+ * @return The offset in 10-bit precision
+ */
+int16_t diffOffset(EDiffChannel ch);
+
+/** Sets how often convertDiff re-measures the offset of a gain stage
+ * @param interval The number of conversions between calibrations, between 1
+ *                 and 254, 0 to only calibrate once, defaults to 100
+ */
+void setDiffCalibrationInterval(uint8_t interval);
+
+/** Starts a conversion on the specified channel without waiting for the result
+ *  Used by drivers which interleave conversions with other work, i.e. from
+ *  a timer interrupt, @see conversionComplete, @see conversionResult.
+ *  - Differential channels are not delayed to let the gain stage settle
+ * @param ch A single-ended or differential A2D channel, @see EChannel, @see EDiffChannel
+ */
+void startConversion(uint8_t ch);
+
+/** Returns whether the conversion started with startConversion completed */
+inline bool conversionComplete(){ return bit_is_clear(ADCSRA, ADSC); }
+
+/** Returns the result of the last completed conversion
+ * @return Converted value in 10-bit precision, sign-extended for differential channels
+ */
+uint16_t conversionResult();
+
+/** Performs conversion on specified single-ended channel in ADC noise reduction sleep mode
+ *  The CPU is halted during the conversion and woken up by the conversion
+ *  complete interrupt, which removes the digital noise of the CPU and of the
+ *  I/O clock domain from the result. If another interrupt wakes up the CPU
+ *  before the conversion completes, the CPU is put back to sleep. The sleep
+ *  mode and interrupt configuration are restored afterwards.
+ *  - Interrupts are enabled while waiting for the conversion, since it
+ *    ends with the A2D interrupt; the previous state is restored afterwards
+ *  - The I/O clock is halted during the conversion: timers (except Timer 2
+ *    in asynchronous mode) pause and bytes arriving on the UARTs are lost
+ *  - Must not be used while a scan or sampling is active
+ * @param ch A single-ended A2D channel, @see EChannel
+ * @return Converted value in 10-bit precision
+ */
+uint16_t convertQuiet10bit(EChannel ch);
+
+/** Performs conversion on specified differential channel in ADC noise reduction sleep mode
+ *  @see convertQuiet10bit, @see convertDiff10bit
+ * @param ch A differential A2D channel, @see EDiffChannel
+ * @return Converted value in 10-bit precision
+ */
+int16_t convertDiffQuiet10bit(EDiffChannel ch);
+
 /** Sets the division ratio of the A2D converter clock
  *  Automatically called from a2dInit() with a default value.
  *  - Has no effect in autotrigger mode.
@@ -160,5 +233,139 @@ void disableDigitalInput(EChannel ch);
  */
 void enableDigitalInput(EChannel ch);
 
+/** An entry of a scan sequence */
+struct ScanEntry {
+	uint8_t channel;      //!< A single-ended or differential channel, @see EChannel, @see EDiffChannel
+	EReference reference; //!< The reference voltage for this channel, @see EReference
+	uint8_t oversample;   //!< Number of extra bits of resolution, between 0 and 3, @see startScan
+};
+
+/** A tagged conversion result */
+struct Sample {
+	uint8_t channel; //!< The converted channel, @see EChannel, @see EDiffChannel
+	uint16_t value;  //!< The converted value in 10+oversample bit precision, sign-extended for differential channels
+};
+
+/** Enables dithering for oversampled conversions
+ *  The specified output pin is toggled before every conversion of an
+ *  oversampled scan entry or of oversampled fixed-rate sampling. The pin is
+ *  meant to be connected to the analog input through a large resistor, such
+ *  that the injected signal is about one LSB peak-to-peak. Dithering is
+ *  required if the input signal is too quiet for oversampling to be effective.
+ *  - The pin must be configured as output
+ *  @param pin The input pins address of the port of the pin (writing to PINx toggles PORTx)
+ *  @param bit The bit of the pin
+ */
+void enableDither(sfr8_t pin, uint8_t bit);
+
+/** Disables dithering */
+void disableDither();
+
+/** Starts an interrupt driven scan of a sequence of channels
+ *  The conversions are chained from the A2D conversion complete interrupt,
+ *  which switches the channel and reference and starts the next conversion.
+ *  The first conversion after a change of the reference voltage or of the
+ *  gain is discarded. The results are tagged with the channel and written to
+ *  the buffer, results which do not fit in the buffer are counted as overruns
+ *  of the buffer.
+ *  Entries with a non-zero oversample value n are converted 4^n times in a
+ *  row, and the sum of the conversions is shifted right by n, which yields a
+ *  result with 10+n bits of resolution (decimation), @see enableDither.
+ *  Values of n above 3 are treated as 3.
+ *  - convert10bit, convertDiff10bit and convertDiff must not be used while a scan is active
+ *  - The sequence must remain valid until the scan is stopped
+ * Example:
+ * @code{.cpp}
+ *   static const A2D::ScanEntry sequence[] = {
+ *     {A2D::CH_0, A2D::REFERENCE_AVCC, 0},
+ *     {A2D::CH_1_0_DIFF10X, A2D::REFERENCE_256V, 0},
+ *     {A2D::CH_110V, A2D::REFERENCE_AVCC, 2} // 12-bit result
+ *   };
+ *   static A2D::Sample samples[16];
+ *   CRingBuffer<A2D::Sample> buffer(samples, 16);
+ *   A2D::init();
+ *   A2D::startScan(sequence, 3, buffer);
+ *   A2D::Sample sample;
+ *   while(true){
+ *     if(buffer.pop(sample)){ ... }
+ *   }
+ * @endcode
+ * @param sequence The channels to convert, in order
+ * @param count The number of entries of the sequence, 0 only stops a running scan
+ * @param buffer The buffer to which the results are written
+ * @param continuous Whether to restart the sequence after the last entry
+ */
+void startScan(const ScanEntry* sequence, uint8_t count, CRingBuffer<Sample>& buffer, bool continuous = true);
+
+/** Stops the scan started with startScan, after the current conversion completes */
+void stopScan();
+
+/** Returns whether a scan is in progress
+ * @return true if a scan is in progress, false if the scan was stopped or a
+ *         non-continuous scan completed
+ */
+bool scanActive();
+
+/** Starts fixed-rate sampling of a channel
+ *  Timer 0 is run in CTC mode at the requested rate and its compare match A
+ *  auto-triggers the conversions, so the sample spacing does not depend on
+ *  interrupt or main loop latency. The results are written to the buffer,
+ *  results which do not fit in the buffer are counted as overruns of the
+ *  buffer.
+ *  - Timer 0 is used exclusively while sampling is active
+ *  - The conversion time (13 A2D clock cycles, @see setPrescaler) must be shorter
+ *    than the sample period, otherwise triggers are missed
+ *  - convert10bit, convertDiff10bit and startScan must not be used while sampling is active
+ * Example:
+ * @code{.cpp}
+ *   static uint16_t samples[64];
+ *   CRingBuffer<uint16_t> buffer(samples, 64);
+ *   A2D::init(A2D::PRESCALE_DIV32);
+ *   A2D::startSampling(A2D::CH_3, 4000, buffer);
+ * @endcode
+ * @param ch A single-ended A2D channel, @see EChannel
+ * @param rate The output sample rate in Hz
+ * @param buffer The buffer to which the results are written
+ * @param oversample Number of extra bits of resolution, between 0 and 3: each
+ *                   result is decimated from 4^oversample conversions, the
+ *                   conversions run at 4^oversample times the sample rate
+ * @return The actual sample rate in Hz, which is the closest rate the timer can produce,
+ *         0 if the rate is 0 or out of range, or oversample is above 3 (the conversions must run at
+ *         F_CPU/262144 to F_CPU), sampling is then not started
+ */
+uint32_t startSampling(EChannel ch, uint32_t rate, CRingBuffer<uint16_t>& buffer, uint8_t oversample = 0);
+
+/** Stops the sampling started with startSampling and releases Timer 0 */
+void stopSampling();
+
+/** Starts fast 8-bit sampling of a channel
+ *  The A2D converter runs in free running mode with a left adjusted result,
+ *  and the conversion complete interrupt stores the 8 most significant bits
+ *  of each result in the buffer. The sample rate is F_CPU/(prescaler*13),
+ *  i.e. about 77 kHz at PRESCALE_DIV16 and 38 kHz at PRESCALE_DIV32. The A2D
+ *  clock then exceeds the 200 kHz required for full 10-bit accuracy, but 8
+ *  bits are still accurate up to about 1 MHz.
+ *  Results which do not fit in the buffer are counted as overruns of the buffer.
+ *  - convert10bit, convertDiff10bit, startScan and startSampling must not be
+ *    used while fast sampling is active
+ * Example:
+ * @code{.cpp}
+ *   static uint8_t samples[128];
+ *   CRingBuffer<uint8_t> buffer(samples, 128);
+ *   A2D::init();
+ *   A2D::startFastSampling(A2D::CH_5, A2D::PRESCALE_DIV16, buffer);
+ * @endcode
+ * @param ch A single-ended A2D channel, @see EChannel
+ * @param prescale The A2D clock division ratio, @see EPrescale
+ * @param buffer The buffer to which the results are written
+ * @return The sample rate in Hz
+ */
+uint32_t startFastSampling(EChannel ch, EPrescale prescale, CRingBuffer<uint8_t>& buffer);
+
+/** Stops the sampling started with startFastSampling and restores the
+ *  previous prescaler and right-adjusted results
+ */
+void stopFastSampling();
+
 }
 #endif
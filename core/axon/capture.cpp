@@ -0,0 +1,146 @@
+/** @file capture.cpp
+ *  @brief Input capture pulse width and PPM decoder, see Atmega640 documentation chapter 17.6.
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "capture.hpp"
+#include "timers.hpp"
+
+#define ICES_BIT 6 // Input capture edge select in TCCRnB
+#define ICF_BIT  5 // Input capture flag in TIFRn
+
+static CInputCapture* capture_instances[6];
+
+// Capture interrupt callback of timer N
+template<uint8_t N>
+static void _captureHandler()
+{
+	typedef TimerRegs<N> R;
+	bool rising = bit_is_set(R::TCCRB(), ICES_BIT);
+	uint16_t icr = R::ICR();
+	if(capture_instances[N]->edge(icr, rising)){
+		// Select the other edge, the flag must be cleared after changing the edge
+		R::TCCRB() ^= _BV(ICES_BIT);
+		R::TIFR() = _BV(ICF_BIT);
+	}
+}
+
+// Sets up (or stops) the capture unit of timer N
+template<uint8_t N>
+static void _captureSetup(bool enable, bool rising)
+{
+	if(!enable){
+		Timer<N>::setCallback(TIMER_INT_CAPT, 0);
+		return;
+	}
+	if(N != 1){
+		Timer<N>::enable(TIMER16_NORMAL, TIMER_CLK_8);
+	}
+	Timer<N>::setCapture(rising, true);
+	Timer<N>::setCallback(TIMER_INT_CAPT, _captureHandler<N>);
+}
+
+static void _captureSetup(uint8_t timer, bool enable, bool rising)
+{
+	switch(timer){
+	case 1: cbi(DDRD, 4); _captureSetup<1>(enable, rising); break;
+	case 3: cbi(DDRE, 7); _captureSetup<3>(enable, rising); break;
+	case 4: cbi(DDRL, 0); _captureSetup<4>(enable, rising); break;
+	case 5: cbi(DDRL, 1); _captureSetup<5>(enable, rising); break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+CInputCapture::CInputCapture(uint8_t timer, EMode mode, bool invert)
+	: m_timer(timer), m_mode(mode), m_invert(invert), m_syncTicks(3000 * (CYCLES_PER_US/8)),
+	  m_last(0), m_synced(false), m_index(0), m_front(0), m_frames(0)
+{
+	m_count[0] = m_count[1] = 0;
+}
+
+void CInputCapture::start()
+{
+	disable_interrupts;
+	m_synced = false;
+	m_index = 0;
+	m_count[0] = m_count[1] = 0;
+	capture_instances[m_timer] = this;
+	// Both modes start on the active edge
+	_captureSetup(m_timer, true, !m_invert);
+	restore_interrupts;
+}
+
+void CInputCapture::stop()
+{
+	disable_interrupts;
+	_captureSetup(m_timer, false, false);
+	restore_interrupts;
+}
+
+uint16_t CInputCapture::channel(uint8_t i) const
+{
+	disable_interrupts;
+	uint8_t front = m_front;
+	uint16_t width = i < m_count[front] ? m_widths[front][i] : 0;
+	restore_interrupts;
+	return width;
+}
+
+uint8_t CInputCapture::read(uint16_t* widths, uint8_t max) const
+{
+	disable_interrupts;
+	uint8_t front = m_front;
+	uint8_t count = m_count[front] < max ? m_count[front] : max;
+	for(uint8_t i = 0; i < count; ++i){
+		widths[i] = m_widths[front][i];
+	}
+	restore_interrupts;
+	return count;
+}
+
+bool CInputCapture::edge(uint16_t icr, bool rising)
+{
+	bool active = rising != m_invert;
+	uint8_t back = m_front ^ 1;
+
+	if(m_mode == MODE_PULSE){
+		if(active){
+			m_last = icr;
+			m_synced = true;
+		}else if(m_synced){
+			m_widths[back][0] = icr - m_last;
+			m_count[back] = 1;
+			publish();
+		}
+		return true;
+	}
+
+	// MODE_PPM: every interval between active edges is a channel, or a sync gap
+	uint16_t width = icr - m_last;
+	m_last = icr;
+	if(width >= m_syncTicks){
+		if(m_synced && m_index > 0){
+			m_count[back] = m_index;
+			publish();
+		}
+		m_synced = true;
+		m_index = 0;
+	}else if(m_synced){
+		if(m_index < MAX_CHANNELS){
+			m_widths[back][m_index++] = width;
+		}else{
+			// Too many channels: discard the frame and wait for the next sync
+			m_synced = false;
+		}
+	}
+	return false;
+}
+
+void CInputCapture::publish()
+{
+	m_front ^= 1;
+	m_frames = m_frames + 1;
+}
@@ -0,0 +1,118 @@
+/** @file capture.hpp
+ *  @brief Input capture pulse width and PPM decoder, see Atmega640 documentation chapter 17.6.
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#include <common.hpp>
+
+/** Input capture decoder
+ *  Edges on the input capture pin ICPn of a 16-bit timer are timestamped by
+ *  the hardware, the interrupt only reads ICRn and toggles the edge select,
+ *  hence the measurements do not suffer from interrupt latency jitter.
+ *  The timer counts at F_CPU/8 (0.5 us resolution at 16 MHz) and widths of
+ *  up to 32.7 ms are measured.
+ *
+ *  Modes:
+ *  - MODE_PULSE: width of the high (or low, if inverted) pulses on the pin,
+ *    i.e. one RC receiver channel or an ultrasonic echo
+ *  - MODE_PPM: interval between consecutive rising (or falling, if
+ *    inverted) edges of a PPM sum signal. A gap longer than the sync gap
+ *    ends a frame, the channels of the frame are then published at once.
+ *
+ *  The measurements are double buffered: the interrupt fills a back buffer
+ *  and swaps it with the front buffer once a frame (or pulse) is complete,
+ *  readers always see a consistent frame.
+ *
+ *  Pins: ICP1 = PD4, ICP3 = PE7, ICP4 = PL0, ICP5 = PL1. Timers 3, 4 and 5
+ *  are set to normal mode at F_CPU/8 by start() (hence can not be used for
+ *  PWM at the same time). Timer 1 is not reconfigured since it is the
+ *  system clock: enable it with Timer1::enable(Timer1::CLK_8).
+ *
+ *  Example:
+ *  @code
+ *  static CInputCapture ppm(5, CInputCapture::MODE_PPM);
+ *  ppm.start();
+ *  ...
+ *  uint16_t ch[CInputCapture::MAX_CHANNELS];
+ *  uint8_t n = ppm.read(ch, CInputCapture::MAX_CHANNELS);
+ *  // ch[i] / 2 is the width of channel i in microseconds
+ *  @endcode
+ */
+class CInputCapture {
+public:
+	enum EMode { MODE_PULSE, MODE_PPM };
+
+	/** Maximum number of PPM channels per frame */
+	static const uint8_t MAX_CHANNELS = 12;
+
+	/** Constructs the decoder
+	 * @param timer The timer, one of 1, 3, 4 and 5
+	 * @param mode The decoding mode, @see EMode
+	 * @param invert Whether the signal is active low
+	 */
+	CInputCapture(uint8_t timer, EMode mode, bool invert = false);
+
+	/** Configures the timer and the pin and starts capturing */
+	void start();
+
+	/** Stops capturing */
+	void stop();
+
+	/** Sets the minimum gap which separates two PPM frames
+	 * @param us The gap in microseconds, defaults to 3000
+	 */
+	void setSyncGap(uint16_t us){ m_syncTicks = us * (CYCLES_PER_US/8); }
+
+	/** Returns the number of channels of the last frame (1 in pulse mode) */
+	uint8_t channels() const{ return m_count[m_front]; }
+
+	/** Returns the width of a channel of the last frame
+	 * @param i The channel index
+	 * @return The width in timer ticks (0.5 us)
+	 */
+	uint16_t channel(uint8_t i) const;
+
+	/** Copies the channels of the last frame
+	 * @param widths The array receiving the widths in timer ticks (0.5 us)
+	 * @param max The size of the array
+	 * @return The number of copied channels
+	 */
+	uint8_t read(uint16_t* widths, uint8_t max) const;
+
+	/** Returns the number of frames (pulses in pulse mode) received so far,
+	 *  wraps around at 256. Compare with a previous value to detect new data.
+	 */
+	uint8_t frames() const{ return m_frames; }
+
+	/** Converts timer ticks to microseconds */
+	static uint16_t ticksToMicros(uint16_t ticks){ return ticks / (CYCLES_PER_US/8); }
+
+	/** Handles a captured edge, called from the capture interrupt
+	 * @param icr The captured timestamp
+	 * @param rising Whether a rising edge was captured
+	 * @return Whether the edge select must be toggled
+	 */
+	bool edge(uint16_t icr, bool rising);
+
+private:
+	uint8_t m_timer;
+	uint8_t m_mode;
+	bool m_invert;
+	uint16_t m_syncTicks;
+	uint16_t m_last;                         // Timestamp of the previous edge
+	bool m_synced;                           // Whether a sync gap was seen (PPM) or an active edge (pulse)
+	uint8_t m_index;                         // Next channel in the back buffer
+	uint16_t m_widths[2][MAX_CHANNELS];
+	uint8_t m_count[2];
+	volatile uint8_t m_front;                // Buffer readers use
+	volatile uint8_t m_frames;
+
+	void publish();
+};
+
+#endif // CAPTURE_HPP
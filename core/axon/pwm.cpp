@@ -6,6 +6,38 @@
  */
 
 #include "pwm.hpp"
+#include "timers.hpp"
+
+#define PWM_CHANNELS 6
+#define PWM_TIMER3_MASK 0b00000111
+#define PWM_TIMER4_MASK 0b00111000
+#define PWM_CLOCK_MASK  0b00000111 // CSn bits of TCCRnB
+
+static uint16_t pwm_staged[PWM_CHANNELS];
+static uint8_t pwm_stagedMask;
+static volatile uint16_t pwm_committed[PWM_CHANNELS];
+static volatile uint8_t pwm_pendingMask;
+
+// Overflow callbacks, called at BOTTOM: the written values are latched at the next BOTTOM
+static void pwm_latch3()
+{
+	uint8_t mask = pwm_pendingMask;
+	if(mask & _BV(PWM::CH_E3)) OCR3A = pwm_committed[PWM::CH_E3];
+	if(mask & _BV(PWM::CH_E4)) OCR3B = pwm_committed[PWM::CH_E4];
+	if(mask & _BV(PWM::CH_E5)) OCR3C = pwm_committed[PWM::CH_E5];
+	pwm_pendingMask = mask & ~PWM_TIMER3_MASK;
+	Timer<3>::disableInterrupt(TIMER_INT_OVF);
+}
+
+static void pwm_latch4()
+{
+	uint8_t mask = pwm_pendingMask;
+	if(mask & _BV(PWM::CH_H3)) OCR4A = pwm_committed[PWM::CH_H3];
+	if(mask & _BV(PWM::CH_H4)) OCR4B = pwm_committed[PWM::CH_H4];
+	if(mask & _BV(PWM::CH_H5)) OCR4C = pwm_committed[PWM::CH_H5];
+	pwm_pendingMask = mask & ~PWM_TIMER4_MASK;
+	Timer<4>::disableInterrupt(TIMER_INT_OVF);
+}
 
 void PWM::initTimer3PWM(uint8_t activePorts)
 {
@@ -58,3 +90,58 @@ void PWM::initTimer4PWM(uint8_t activePorts)
 	// Clear timer counter
 	TCNT4 = 0x0000;
 }
+
+void PWM::stage(EChannel channel, uint16_t val)
+{
+	pwm_staged[channel] = val;
+	pwm_stagedMask |= _BV(channel);
+}
+
+void PWM::commit()
+{
+	uint8_t mask = pwm_stagedMask;
+	pwm_stagedMask = 0;
+	disable_interrupts;
+	for(uint8_t i = 0; i < PWM_CHANNELS; ++i){
+		if(mask & _BV(i)){
+			pwm_committed[i] = pwm_staged[i];
+		}
+	}
+	// A stopped timer never overflows: write its values now
+	if((TCCR3B & PWM_CLOCK_MASK) == 0 && (mask & PWM_TIMER3_MASK)){
+		pwm_pendingMask |= mask & PWM_TIMER3_MASK;
+		pwm_latch3();
+		mask &= ~PWM_TIMER3_MASK;
+	}
+	if((TCCR4B & PWM_CLOCK_MASK) == 0 && (mask & PWM_TIMER4_MASK)){
+		pwm_pendingMask |= mask & PWM_TIMER4_MASK;
+		pwm_latch4();
+		mask &= ~PWM_TIMER4_MASK;
+	}
+	pwm_pendingMask |= mask;
+	// The callbacks must run right after a BOTTOM: setCallback clears a
+	// stale overflow flag, which may have been set cycles ago
+	if(mask & PWM_TIMER3_MASK){
+		Timer<3>::setCallback(TIMER_INT_OVF, pwm_latch3);
+	}
+	if(mask & PWM_TIMER4_MASK){
+		Timer<4>::setCallback(TIMER_INT_OVF, pwm_latch4);
+	}
+	restore_interrupts;
+}
+
+bool PWM::pending()
+{
+	return pwm_pendingMask != 0;
+}
+
+void PWM::synchronize()
+{
+	disable_interrupts;
+	// Halt the prescaler while the counters are reset
+	GTCCR = _BV(TSM) | _BV(PSRSYNC);
+	TCNT3 = 0x0000;
+	TCNT4 = 0x0000;
+	GTCCR = 0x00;
+	restore_interrupts;
+}
@@ -35,32 +35,80 @@ namespace PWM {
 	/** Sets the value of PWM E3
 	 * @param val The pulse time in milliseconds, between 1000 and 2000
 	 */
-	inline void setE3(uint16_t val){ OCR3A = val; }
+	inline void setE3(uint16_t val){ disable_interrupts; OCR3A = val; restore_interrupts; }
 
 	/** Sets the value of PWM E4
 	 * @param val The pulse time in milliseconds, between 1000 and 2000
 	 */
-	inline void setE4(uint16_t val){ OCR3B = val; }
+	inline void setE4(uint16_t val){ disable_interrupts; OCR3B = val; restore_interrupts; }
 
 	/** Sets the value of PWM E5
 	 * @param val The pulse time in milliseconds, between 1000 and 2000
 	 */
-	inline void setE5(uint16_t val){ OCR3C = val; }
+	inline void setE5(uint16_t val){ disable_interrupts; OCR3C = val; restore_interrupts; }
 
 	/** Sets the value of PWM H3
 	 * @param val The pulse time in milliseconds, between 1000 and 2000
 	 */
-	inline void setH3(uint16_t val){ OCR4A = val; }
+	inline void setH3(uint16_t val){ disable_interrupts; OCR4A = val; restore_interrupts; }
 
 	/** Sets the value of PWM H4
 	 * @param val The pulse time in milliseconds, between 1000 and 2000
 	 */
-	inline void setH4(uint16_t val){ OCR4B = val; }
+	inline void setH4(uint16_t val){ disable_interrupts; OCR4B = val; restore_interrupts; }
 
 	/** Sets the value of PWM H5
 	 * @param val The pulse time in milliseconds, between 1000 and 2000
 	 */
-	inline void setH5(uint16_t val){ OCR4C = val; }
+	inline void setH5(uint16_t val){ disable_interrupts; OCR4C = val; restore_interrupts; }
+
+	/** The channels, for batched updates */
+	enum EChannel {
+		CH_E3 = 0,
+		CH_E4 = 1,
+		CH_E5 = 2,
+		CH_H3 = 3,
+		CH_H4 = 4,
+		CH_H5 = 5
+	};
+
+	/** Stages the value of a channel, applied by commit()
+	 *  The OCRnx registers are latched at BOTTOM: setting them one at a time
+	 *  may straddle the latch, so that some channels change a cycle before
+	 *  the others. Staged values are written together in the overflow
+	 *  interrupt of their timer, right after BOTTOM, and hence all take
+	 *  effect at the following BOTTOM. Channels which are not staged keep
+	 *  their value.
+	 * @param channel The channel
+	 * @param val The pulse time in microseconds, between 1000 and 2000
+	 */
+	void stage(EChannel channel, uint16_t val);
+
+	/** Commits the staged values
+	 *  The values take effect at the second BOTTOM of the timers from now,
+	 *  i.e. after at most two PWM cycles. Committing again before they are
+	 *  applied replaces the pending values. Values of a timer which is not
+	 *  running are written immediately. Uses the overflow interrupts of
+	 *  Timers 3 and 4, @see timers.hpp
+	 *
+	 *  The interrupt writes the 16-bit compare registers, which share the
+	 *  TEMP register of the timer with all other 16-bit accesses: while a
+	 *  commit is pending, such accesses to Timers 3 and 4 from the main
+	 *  context must disable interrupts (setE3 to setH5 and Timer<N> do).
+	 */
+	void commit();
+
+	/** Returns whether committed values are still pending */
+	bool pending();
+
+	/** Synchronizes the phase of Timers 3 and 4
+	 *  Halts the synchronous prescaler with GTCCR.TSM, resets both counters
+	 *  and restarts them together, so that both timers reach BOTTOM at the
+	 *  same time and committed values of all six channels take effect in the
+	 *  same cycle. Call after initTimer3PWM and initTimer4PWM. The prescaler
+	 *  is shared with Timers 0, 1 and 5, which are stalled for a few cycles.
+	 */
+	void synchronize();
 }
 
 #endif
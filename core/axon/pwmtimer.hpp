@@ -0,0 +1,200 @@
+/** @file pwmtimer.hpp
+ *  @brief Configurable-frequency PWM on the 16-bit timers
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef PWMTIMER_HPP
+#define PWMTIMER_HPP
+
+#include "timers.hpp"
+
+/** Duty cycle of 100% in Q15 units */
+#define PWM_DUTY_MAX 0x8000
+
+/** PWM waveform */
+enum EPWMMode {
+	PWM_FAST,         //!< Fast PWM: single slope, highest frequency
+	PWM_PHASE_CORRECT //!< Phase and frequency correct PWM: dual slope, centered pulses
+};
+
+/** Output pins of the compare units, OCnA is bit BIT, OCnB bit BIT+1, OCnC bit BIT+2 */
+template<uint8_t N> struct PWMPins;
+
+#define PWM_DEFINE_PINS(n, ddr, bit) \
+	template<> struct PWMPins<n> { \
+		static sfr8_t DDR(){ return ddr; } \
+		static const uint8_t BIT = bit; \
+	}
+
+PWM_DEFINE_PINS(1, DDRB, 5); // PB5..7
+PWM_DEFINE_PINS(3, DDRE, 3); // PE3..5
+PWM_DEFINE_PINS(4, DDRH, 3); // PH3..5
+PWM_DEFINE_PINS(5, DDRL, 3); // PL3..5
+
+#undef PWM_DEFINE_PINS
+
+/** PWM with configurable carrier frequency on Timers 1, 3, 4 and 5
+ *  Unlike PWM::initTimer3PWM, which produces 50 Hz servo pulses, the
+ *  carrier frequency and mode are free, i.e. 20 kHz for motor drivers.
+ *  TOP is stored in ICRn, init() selects the smallest prescaler for the
+ *  frequency, which gives the highest resolution (TOP + 1 steps, i.e.
+ *  800 steps at 20 kHz in fast mode).
+ *
+ *  The duty cycle is given in Q15 units, 0 to PWM_DUTY_MAX (100%). In fast
+ *  mode, a duty of 0 still gives a pulse of one timer tick; phase correct
+ *  mode produces clean 0% and 100%.
+ *
+ *  Complementary outputs drive both switches of a half bridge from two
+ *  channels: the second channel is the inverse of the first, separated by
+ *  a dead time during which both are low. Pairs require phase correct mode:
+ *  in fast mode, both outputs change at BOTTOM simultaneously, which shorts
+ *  the bridge. The on-time of the non-inverted channel saturates at TOP
+ *  minus half the dead time.
+ *
+ *  Timer 1 is the Timer1 clock and Timer 5 the profiler timer, @see
+ *  timers.hpp: using them for PWM excludes these modules.
+ *
+ *  @code
+ *  // 20 kHz motor drive on OC3A, half bridge with 0.5 us dead time on OC4A/OC4B
+ *  PWMTimer<3>::init(20000UL);
+ *  PWMTimer<3>::enableChannel(TIMER_CH_A);
+ *  PWMTimer<3>::setDuty(TIMER_CH_A, PWM_DUTY_MAX / 4);
+ *  PWMTimer<4>::init(20000UL, PWM_PHASE_CORRECT);
+ *  PWMTimer<4>::enableComplementary(TIMER_CH_A, TIMER_CH_B, 8);
+ *  PWMTimer<4>::setDuty(TIMER_CH_A, PWM_DUTY_MAX / 2);
+ *  @endcode
+ */
+template<uint8_t N>
+class PWMTimer {
+	typedef Timer<N> T;
+	typedef PWMPins<N> P;
+
+	static uint16_t m_top;      //!< TOP (ICRn)
+	static bool m_phaseCorrect; //!< Whether the mode is phase and frequency correct
+	static uint8_t m_pairMask;  //!< Bit ch set: channel ch drives a complementary pair
+	static uint8_t m_pairInv[3]; //!< The inverted channel of each pair
+	static uint16_t m_dead;     //!< Dead time in timer ticks
+
+public:
+	/** Start the timer with the given carrier frequency
+	 * @param frequency The carrier frequency in Hz
+	 * @param mode The waveform, @see EPWMMode
+	 * @return The actual frequency in Hz, 0 if it is 0 or cannot be reached
+	 */
+	static uint32_t init(uint32_t frequency, EPWMMode mode = PWM_FAST){
+		static const uint8_t shifts[] = {0, 3, 6, 8, 10};
+		if(frequency == 0){
+			return 0;
+		}
+		for(uint8_t i = 0; i < 5; ++i){
+			uint32_t top = (F_CPU >> shifts[i]) / frequency;
+			top = mode == PWM_PHASE_CORRECT ? top / 2 : top - 1;
+			if(top <= 0xFFFF){
+				if(top < 3){
+					return 0;
+				}
+				initTop(top, TIMER_CLK_1 + i, mode);
+				top = mode == PWM_PHASE_CORRECT ? 2 * top : top + 1;
+				return (F_CPU >> shifts[i]) / top;
+			}
+		}
+		return 0;
+	}
+
+	/** Start the timer with explicit resolution and clock
+	 * @param top TOP, the resolution is TOP + 1 steps
+	 * @param clock The clock source, @see ETimerClock
+	 * @param mode The waveform, @see EPWMMode
+	 */
+	static void initTop(uint16_t top, uint8_t clock, EPWMMode mode = PWM_FAST){
+		T::disable();
+		m_top = top;
+		m_phaseCorrect = mode == PWM_PHASE_CORRECT;
+		m_pairMask = 0;
+		T::setTop(top);
+		T::setCount(0);
+		T::enable(m_phaseCorrect ? TIMER16_PWM_PFC_ICR : TIMER16_FAST_PWM_ICR, clock);
+	}
+
+	/** Return TOP */
+	static uint16_t top(){ return m_top; }
+
+	/** Connect a channel to its pin
+	 * @param ch The channel
+	 * @param inverted Whether the output is low during the duty cycle
+	 */
+	static void enableChannel(ETimerChannel ch, bool inverted = false){
+		m_pairMask &= ~_BV(ch);
+		T::setOutput(ch, inverted ? TIMER_OUT_SET : TIMER_OUT_CLEAR);
+		P::DDR() |= _BV(P::BIT + ch);
+	}
+
+	/** Disconnect a channel from its pin (the pin keeps its port value) */
+	static void disableChannel(ETimerChannel ch){
+		m_pairMask &= ~_BV(ch);
+		T::setOutput(ch, TIMER_OUT_DISCONNECTED);
+	}
+
+	/** Connect two channels as a complementary pair
+	 *  setDuty(ch) then sets both channels, inv is high when ch is low.
+	 * @param ch The non-inverted channel
+	 * @param inv The inverted channel
+	 * @param deadTicks The dead time in timer ticks (prescaler / F_CPU seconds)
+	 * @return false if the timer is not in phase correct mode, true otherwise
+	 */
+	static bool enableComplementary(ETimerChannel ch, ETimerChannel inv, uint16_t deadTicks){
+		if(!m_phaseCorrect){
+			return false;
+		}
+		enableChannel(ch, false);
+		enableChannel(inv, true);
+		m_pairInv[ch] = inv;
+		m_dead = deadTicks;
+		m_pairMask |= _BV(ch);
+		return true;
+	}
+
+	/** Set the duty cycle of a channel (or complementary pair)
+	 * @param ch The channel
+	 * @param duty The duty cycle, 0 to PWM_DUTY_MAX
+	 */
+	static void setDuty(ETimerChannel ch, uint16_t duty){
+		if(duty > PWM_DUTY_MAX){
+			duty = PWM_DUTY_MAX;
+		}
+		uint16_t value = (uint32_t(duty) * (m_phaseCorrect ? m_top : m_top + 1UL)) >> 15;
+		if(value > m_top){
+			value = m_top;
+		}
+		if(!(m_pairMask & _BV(ch))){
+			T::setCompare(ch, value);
+			return;
+		}
+		// Non-inverted output high below OCR_ch, inverted high above OCR_inv
+		uint16_t low = value > m_dead / 2 ? value - m_dead / 2 : 0;
+		uint32_t high = uint32_t(low) + m_dead;
+		if(high > m_top){
+			high = m_top;
+		}
+		ETimerChannel inv = ETimerChannel(m_pairInv[ch]);
+		// Write order such that the gap never shrinks below the dead time, even
+		// if the compare registers are latched between the two writes
+		if(low > T::compare(ch)){
+			T::setCompare(inv, high);
+			T::setCompare(ch, low);
+		}else{
+			T::setCompare(ch, low);
+			T::setCompare(inv, high);
+		}
+	}
+};
+
+template<uint8_t N> uint16_t PWMTimer<N>::m_top;
+template<uint8_t N> bool PWMTimer<N>::m_phaseCorrect;
+template<uint8_t N> uint8_t PWMTimer<N>::m_pairMask;
+template<uint8_t N> uint8_t PWMTimer<N>::m_pairInv[3];
+template<uint8_t N> uint16_t PWMTimer<N>::m_dead;
+
+#endif // PWMTIMER_HPP
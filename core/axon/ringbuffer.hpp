@@ -0,0 +1,108 @@
+/** @file ringbuffer.hpp
+ *  @brief Lock-free single-producer single-consumer ring buffer.
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <common.hpp>
+
+/** A typed ring buffer
+ *  Ring buffer for passing elements from an interrupt handler to the main
+ *  program (or vice versa). Unlike CBuffer, the storage is provided by the
+ *  caller and no interrupts are disabled: there must be exactly one producer
+ *  (calling push) and one consumer (calling pop/read). The read and write
+ *  indices are single bytes, which are read and written atomically.
+ *  The size must be a power of two between 2 and 256, the buffer holds at
+ *  most size - 1 elements.
+ *  Example:
+ *  @code{.cpp}
+ *    static uint16_t samples[32];
+ *    CRingBuffer<uint16_t> buffer(samples, sizeof(samples)/sizeof(samples[0]));
+ *  @endcode
+ */
+template<typename T>
+class CRingBuffer {
+private:
+	T* m_data;                    //!< Physical memory address where the buffer is stored
+	uint8_t m_mask;               //!< Size of the buffer minus one
+	volatile uint8_t m_head;      //!< Index where the next element is written
+	volatile uint8_t m_tail;      //!< Index where the next element is read
+	volatile uint16_t m_overruns; //!< Number of elements which did not fit in the buffer
+
+public:
+	/** Constructs a ring buffer
+	 * @param data The storage for the elements
+	 * @param size The number of elements of the storage, must be a power of two
+	 */
+	CRingBuffer(T* data, uint16_t size)
+		: m_data(data), m_mask(size - 1), m_head(0), m_tail(0), m_overruns(0) {}
+
+	/** Add an element to the end of the buffer (producer)
+	 * @param data The element to add
+	 * @return true on success, false if the buffer is full
+	 */
+	bool push(const T& data){
+		uint8_t head = m_head;
+		uint8_t next = (head + 1) & m_mask;
+		if(next == m_tail){
+			m_overruns = m_overruns + 1;
+			return false;
+		}
+		m_data[head] = data;
+		// The element must be stored before it is published
+		__asm__ __volatile__("" ::: "memory");
+		m_head = next;
+		return true;
+	}
+
+	/** Get and remove the first element from the front of the buffer (consumer)
+	 * @param data The removed element
+	 * @return true on success, false if the buffer is empty
+	 */
+	bool pop(T& data){
+		uint8_t tail = m_tail;
+		if(tail == m_head){
+			return false;
+		}
+		data = m_data[tail];
+		__asm__ __volatile__("" ::: "memory");
+		m_tail = (tail + 1) & m_mask;
+		return true;
+	}
+
+	/** Get and remove up to count elements from the front of the buffer (consumer)
+	 * @param data The array where to store the removed elements
+	 * @param count The maximum number of elements to remove
+	 * @return The number of removed elements
+	 */
+	uint8_t read(T* data, uint8_t count){
+		uint8_t n = 0;
+		while(n < count && pop(data[n])){
+			++n;
+		}
+		return n;
+	}
+
+	/** Flush (clear) the contents of the buffer (consumer) */
+	void clear(){ m_tail = m_head; }
+
+	/** Get the number of elements in the buffer */
+	uint8_t size() const{ return (m_head - m_tail) & m_mask; }
+
+	/** Returns whether the buffer is empty */
+	bool empty() const{ return m_head == m_tail; }
+
+	/** Get the number of elements which were discarded because the buffer was full */
+	uint16_t overruns() const{
+		disable_interrupts;
+		uint16_t overruns = m_overruns;
+		restore_interrupts;
+		return overruns;
+	}
+};
+
+#endif
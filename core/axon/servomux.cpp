@@ -0,0 +1,194 @@
+/** @file servomux.cpp
+ *  @brief Interrupt-driven servo pulses on up to 24 GPIO pins
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "servomux.hpp"
+#include "timers.hpp"
+
+typedef Timer<SERVOMUX_TIMER> ServoTimer;
+
+#define SERVOMUX_FRAME  40000 // 20 ms at F_CPU/8
+#define SERVOMUX_OFFSET 64    // Start of the first slot
+#define SERVOMUX_SLOT   (SERVOMUX_FRAME / SERVOMUX_SLOTS)
+#define SERVOMUX_END    (SERVOMUX_FRAME - 32) // End of frame marker, after the last possible edge
+#define SERVOMUX_SPIN   24    // Edges closer than 12 us are waited for in the interrupt
+#define SERVOMUX_EDGES  (2 * SERVOMUX_SERVOS + 1)
+
+struct ServoEdge {
+	uint16_t time;              //!< Counter value of the edge
+	volatile uint8_t* port;     //!< The port, 0 marks the end of the frame
+	uint8_t mask;               //!< The pins of the port
+	bool rising;                //!< Whether the pins are set or cleared
+};
+
+struct Servo {
+	volatile uint8_t* port;     //!< The port, 0 if detached
+	uint8_t mask;               //!< The pin of the port
+	uint16_t width;             //!< The staged width in timer ticks
+};
+
+static Servo servomux_servos[SERVOMUX_SERVOS];
+static ServoEdge servomux_edges[2][SERVOMUX_EDGES];
+static uint8_t servomux_front;                // List used by the interrupt
+static volatile bool servomux_ready;          // Whether the back list is to be swapped in
+static const ServoEdge* servomux_next = servomux_edges[0]; // Next edge of the interrupt
+
+// Insert an edge into the edges [first, n) sorted by time, merging it
+// with an edge of the same time, port and direction
+static void servomux_insert(ServoEdge* edges, uint8_t first, uint8_t& n,
+                            uint16_t time, volatile uint8_t* port, uint8_t mask, bool rising)
+{
+	uint8_t i = n;
+	while(i > first && edges[i - 1].time > time){
+		--i;
+	}
+	for(uint8_t j = i; j > first && edges[j - 1].time == time; --j){
+		if(edges[j - 1].port == port && edges[j - 1].rising == rising){
+			edges[j - 1].mask |= mask;
+			return;
+		}
+	}
+	for(uint8_t j = n; j > i; --j){
+		edges[j] = edges[j - 1];
+	}
+	edges[i].time = time;
+	edges[i].port = port;
+	edges[i].mask = mask;
+	edges[i].rising = rising;
+	++n;
+}
+
+static void servomux_build(ServoEdge* edges)
+{
+	uint8_t n = 0;
+	for(uint8_t slot = 0; slot < SERVOMUX_SLOTS; ++slot){
+		uint16_t start = SERVOMUX_OFFSET + slot * SERVOMUX_SLOT;
+		uint8_t first = n;
+		for(uint8_t s = slot; s < SERVOMUX_SERVOS; s += SERVOMUX_SLOTS){
+			const Servo& servo = servomux_servos[s];
+			if(servo.port != 0){
+				servomux_insert(edges, first, n, start, servo.port, servo.mask, true);
+				servomux_insert(edges, first, n, start + servo.width, servo.port, servo.mask, false);
+			}
+		}
+	}
+	// The list is swapped at the end marker, just before the counter wraps
+	edges[n].time = SERVOMUX_END;
+	edges[n].port = 0;
+}
+
+static void servomux_compare()
+{
+	const ServoEdge* edge = servomux_next;
+	for(;;){
+		volatile uint8_t* port = edge->port;
+		if(port == 0){
+			// End of the frame: the first edge of the next one is before the
+			// counter, hence matches after the wrap
+			if(servomux_ready){
+				servomux_front ^= 1;
+				servomux_ready = false;
+			}
+			edge = servomux_edges[servomux_front];
+			break;
+		}
+		if(edge->rising){
+			*port |= edge->mask;
+		}else{
+			*port &= ~edge->mask;
+		}
+		++edge;
+		// The edges of a frame never wrap around
+		uint16_t time = edge->time;
+		if(time > ServoTimer::count() + SERVOMUX_SPIN){
+			break;
+		}
+		while(ServoTimer::count() < time){
+		}
+	}
+	servomux_next = edge;
+	ServoTimer::setCompare(TIMER_CH_A, edge->time);
+}
+
+bool ServoMux::attach(uint8_t servo, sfr8_t ddr, sfr8_t port, uint8_t bit, uint16_t us)
+{
+	if(servo >= SERVOMUX_SERVOS){
+		return false;
+	}
+	disable_interrupts;
+	cbi(port, bit);
+	sbi(ddr, bit);
+	restore_interrupts;
+	servomux_servos[servo].port = &port;
+	servomux_servos[servo].mask = _BV(bit);
+	set(servo, us);
+	return true;
+}
+
+void ServoMux::detach(uint8_t servo)
+{
+	if(servo < SERVOMUX_SERVOS){
+		servomux_servos[servo].port = 0;
+	}
+}
+
+void ServoMux::set(uint8_t servo, uint16_t us)
+{
+	if(servo >= SERVOMUX_SERVOS){
+		return;
+	}
+	if(us < SERVOMUX_MIN_US){
+		us = SERVOMUX_MIN_US;
+	}else if(us > SERVOMUX_MAX_US){
+		us = SERVOMUX_MAX_US;
+	}
+	servomux_servos[servo].width = 2 * us;
+}
+
+void ServoMux::commit()
+{
+	// Withdraw a list which was not swapped in yet, the interrupt then only
+	// reads the front list while the back list is rebuilt
+	disable_interrupts;
+	servomux_ready = false;
+	uint8_t back = servomux_front ^ 1;
+	restore_interrupts;
+	servomux_build(servomux_edges[back]);
+	// Compiler barrier: the list is complete in memory before it is flagged
+	__asm__ __volatile__("" ::: "memory");
+	servomux_ready = true;
+}
+
+bool ServoMux::pending()
+{
+	return servomux_ready;
+}
+
+void ServoMux::start()
+{
+	ServoTimer::disable();
+	// The interrupt is off: build the front list from the staged widths
+	servomux_ready = false;
+	servomux_build(servomux_edges[servomux_front]);
+	servomux_next = servomux_edges[servomux_front];
+	ServoTimer::setTop(SERVOMUX_FRAME - 1);
+	ServoTimer::setCount(0);
+	ServoTimer::setCompare(TIMER_CH_A, servomux_next->time);
+	ServoTimer::setCallback(TIMER_INT_COMPA, servomux_compare);
+	ServoTimer::enable(TIMER16_CTC_ICR, TIMER_CLK_8);
+}
+
+void ServoMux::stop()
+{
+	ServoTimer::disable();
+	disable_interrupts;
+	for(uint8_t i = 0; i < SERVOMUX_SERVOS; ++i){
+		if(servomux_servos[i].port != 0){
+			*servomux_servos[i].port &= ~servomux_servos[i].mask;
+		}
+	}
+	restore_interrupts;
+}
@@ -0,0 +1,106 @@
+/** @file servomux.hpp
+ *  @brief Interrupt-driven servo pulses on up to 24 GPIO pins
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef SERVOMUX_HPP
+#define SERVOMUX_HPP
+
+#include <common.hpp>
+
+/** The 16-bit timer used by the multiplexer (3, 4 or 5) */
+#ifndef SERVOMUX_TIMER
+#define SERVOMUX_TIMER 5
+#endif
+
+#if SERVOMUX_TIMER == 1
+#  error "Timer 1 is the Timer1 clock and drives CSoftTimer, use Timer 3, 4 or 5"
+#elif SERVOMUX_TIMER != 3 && SERVOMUX_TIMER != 4 && SERVOMUX_TIMER != 5
+#  error "SERVOMUX_TIMER must be 3, 4 or 5"
+#endif
+
+#define SERVOMUX_SLOTS   8  //!< Time slots of 2.5 ms per 20 ms frame
+#define SERVOMUX_SERVOS  24 //!< Number of servos (three per slot)
+#define SERVOMUX_MIN_US  500
+#define SERVOMUX_MAX_US  2400
+
+/** Servo multiplexer
+ *  Generates 50 Hz servo pulses on arbitrary port pins, in addition to the
+ *  six hardware PWM channels of Timers 3 and 4 (with the default timer). SERVOMUX_TIMER counts the
+ *  20 ms frame at F_CPU/8 (0.5 us resolution) in CTC mode. The frame is
+ *  divided into SERVOMUX_SLOTS slots of 2.5 ms: servo i is in slot
+ *  i % SERVOMUX_SLOTS, so up to eight servos get a slot each. The pulses
+ *  of a slot start together and end after their widths.
+ *
+ *  commit() precomputes the sorted list of the edges of the frame (rising
+ *  edges of the same port merged), the compare A interrupt then only
+ *  applies the next edge and schedules the one after. Edges closer than
+ *  the interrupt latency are applied in the same interrupt, waiting for
+ *  the counter. New lists are swapped in at the end of a frame, so that
+ *  each frame is consistent.
+ *
+ *  The pins are written with read-modify-write sequences from the
+ *  interrupt: on the ports used by the multiplexer, only single-bit sbi/cbi
+ *  writes on ports A to G are atomic. Any other read-modify-write from the
+ *  main context (several bits, i.e. PORTA |= 0x03, or any bit on ports H
+ *  to L) must be done with interrupts disabled.
+ *
+ *  Each servo needs a pin of its own: servos sharing a pin and a slot would
+ *  be cut by the first falling edge.
+ *
+ *  SERVOMUX_TIMER defaults to Timer 5, which then cannot be used by the
+ *  profiler, @see timers.hpp. Timers 3 and 4 may be used instead, but the
+ *  hardware PWM channels of that timer are then unavailable (@see PWM).
+ *  Timer 1 cannot be used, it is the Timer1 clock.
+ *
+ *  @code
+ *  // 18 servos: PL0..7, PK0..7, PC0..1
+ *  for(uint8_t i = 0; i < 8; ++i){
+ *  	ServoMux::attach(i, DDRL, PORTL, i);
+ *  	ServoMux::attach(i + 8, DDRK, PORTK, i);
+ *  }
+ *  ServoMux::attach(16, DDRC, PORTC, 0);
+ *  ServoMux::attach(17, DDRC, PORTC, 1);
+ *  ServoMux::start();
+ *  ...
+ *  ServoMux::set(leg, 1500);
+ *  ServoMux::commit();
+ *  @endcode
+ */
+namespace ServoMux {
+	/** Attach a servo to a pin and make the pin an output
+	 *  Takes effect with the next commit().
+	 * @param servo The servo index, less than SERVOMUX_SERVOS
+	 * @param ddr The data direction register of the pin
+	 * @param port The port register of the pin
+	 * @param bit The bit of the pin
+	 * @param us The initial pulse width in microseconds
+	 * @return Whether the servo index is valid
+	 */
+	bool attach(uint8_t servo, sfr8_t ddr, sfr8_t port, uint8_t bit, uint16_t us = 1500);
+
+	/** Stop the pulses of a servo, takes effect with the next commit() */
+	void detach(uint8_t servo);
+
+	/** Stage the pulse width of a servo, takes effect with the next commit()
+	 * @param servo The servo index
+	 * @param us The pulse width in microseconds, clamped to SERVOMUX_MIN_US to SERVOMUX_MAX_US
+	 */
+	void set(uint8_t servo, uint16_t us);
+
+	/** Precompute the edges of the staged widths, applied from the next frame on */
+	void commit();
+
+	/** Returns whether committed widths are not yet applied */
+	bool pending();
+
+	/** Start the timer */
+	void start();
+
+	/** Stop the timer, the pins are left low */
+	void stop();
+}
+
+#endif // SERVOMUX_HPP
@@ -0,0 +1,196 @@
+/** @file softtimer.cpp
+ *  @brief Software timers driven by the Timer1 compare A interrupt.
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "softtimer.hpp"
+#include "timer.hpp"
+
+#if (SOFTTIMER_WHEEL_SIZE & (SOFTTIMER_WHEEL_SIZE - 1)) != 0
+#  error "SOFTTIMER_WHEEL_SIZE must be a power of two"
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+static CSoftTimer* softtimer_near;                         // Timers due in the current period, sorted by deadline
+static CSoftTimer* softtimer_wheel[SOFTTIMER_WHEEL_SIZE];  // Timers due in later periods, hashed by period
+static uint16_t softtimer_margin = 2;                      // Minimum distance of the compare value to the counter
+
+void _softTimerCompare();
+
+///////////////////////////////////////////////////////////////////////////////
+
+CSoftTimer::CSoftTimer(Callback callback, void* arg)
+	: m_next(0), m_pprev(0), m_deadline(0), m_period(0), m_callback(callback), m_arg(arg), m_fired(0)
+{
+}
+
+void CSoftTimer::init()
+{
+	// Leave enough time between reading the counter and writing the compare register
+	softtimer_margin = Timer1::microsToTicks(8);
+	if(softtimer_margin < 2){
+		softtimer_margin = 2;
+	}
+	Timer1::setOverflowHook(overflow);
+	disable_interrupts;
+	program();
+	restore_interrupts;
+}
+
+void CSoftTimer::startOneShot(uint32_t us)
+{
+	startTicks(Timer1::microsToTicks(us), 0);
+}
+
+void CSoftTimer::startPeriodic(uint32_t us)
+{
+	uint32_t ticks = Timer1::microsToTicks(us);
+	if(ticks == 0){
+		ticks = 1;
+	}
+	startTicks(ticks, ticks);
+}
+
+void CSoftTimer::startTicks(uint32_t delay, uint32_t period)
+{
+	disable_interrupts;
+	bool wasHead = softtimer_near == this;
+	unlink();
+	uint32_t now = Timer1::ticks();
+	m_deadline = now + delay;
+	m_period = period;
+	schedule(now >> 16);
+	if(wasHead || softtimer_near == this){
+		program();
+	}
+	restore_interrupts;
+}
+
+void CSoftTimer::stop()
+{
+	disable_interrupts;
+	bool wasHead = softtimer_near == this;
+	unlink();
+	if(wasHead){
+		program();
+	}
+	restore_interrupts;
+}
+
+uint8_t CSoftTimer::expired()
+{
+	disable_interrupts;
+	uint8_t fired = m_fired;
+	m_fired = 0;
+	restore_interrupts;
+	return fired;
+}
+
+// Inserts the timer in the near list or the wheel, interrupts must be disabled
+void CSoftTimer::schedule(uint16_t period)
+{
+	CSoftTimer** pp;
+	if(int16_t(uint16_t(m_deadline >> 16) - period) <= 0){
+		// Due in the current period: sorted insert
+		pp = &softtimer_near;
+		while(*pp != 0 && int32_t((*pp)->m_deadline - m_deadline) <= 0){
+			pp = &(*pp)->m_next;
+		}
+	}else{
+		pp = &softtimer_wheel[uint16_t(m_deadline >> 16) & (SOFTTIMER_WHEEL_SIZE - 1)];
+	}
+	m_next = *pp;
+	if(m_next != 0){
+		m_next->m_pprev = &m_next;
+	}
+	*pp = this;
+	m_pprev = pp;
+}
+
+// Removes the timer from its list, interrupts must be disabled
+void CSoftTimer::unlink()
+{
+	if(m_pprev == 0){
+		return;
+	}
+	*m_pprev = m_next;
+	if(m_next != 0){
+		m_next->m_pprev = m_pprev;
+	}
+	m_next = 0;
+	m_pprev = 0;
+}
+
+// Programs compare unit A for the first deadline, interrupts must be disabled
+void CSoftTimer::program()
+{
+	CSoftTimer* head = softtimer_near;
+	uint32_t now = Timer1::ticks();
+	int32_t diff = head != 0 ? int32_t(head->m_deadline - now) : 0;
+	if(head == 0 || (diff > 0 && uint16_t(head->m_deadline >> 16) != uint16_t(now >> 16))){
+		// Nothing due in this period, the overflow hook reprograms the compare unit
+		cbi(TIMSK1, OCIE1A);
+		return;
+	}
+	if(diff < int32_t(softtimer_margin)){
+		// Due or too close to program exactly: fire as soon as possible
+		OCR1A = uint16_t(now) + softtimer_margin;
+	}else{
+		OCR1A = uint16_t(head->m_deadline);
+	}
+	TIFR1 = _BV(OCF1A); /* Clear stale match */
+	sbi(TIMSK1, OCIE1A);
+}
+
+// Fires all expired timers, called from the compare interrupt
+void CSoftTimer::dispatch()
+{
+	for(;;){
+		CSoftTimer* t = softtimer_near;
+		uint32_t now = Timer1::ticks();
+		if(t == 0 || int32_t(t->m_deadline - now) > 0){
+			break;
+		}
+		t->unlink();
+		if(t->m_fired != 0xFF){
+			++t->m_fired;
+		}
+		if(t->m_period != 0){
+			t->m_deadline += t->m_period;
+			t->schedule(now >> 16);
+		}
+		if(t->m_callback != 0){
+			t->m_callback(t->m_arg);
+		}
+	}
+	program();
+}
+
+// Moves the timers of the new period from the wheel to the near list, called from the overflow interrupt
+void CSoftTimer::overflow()
+{
+	uint16_t period = Timer1::ticks() >> 16;
+	CSoftTimer* t = softtimer_wheel[period & (SOFTTIMER_WHEEL_SIZE - 1)];
+	while(t != 0){
+		CSoftTimer* next = t->m_next;
+		if(int16_t(uint16_t(t->m_deadline >> 16) - period) <= 0){
+			t->unlink();
+			t->schedule(period);
+		}
+		t = next;
+	}
+	program();
+}
+
+void _softTimerCompare()
+{
+	CSoftTimer::dispatch();
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+	_softTimerCompare();
+}
@@ -0,0 +1,108 @@
+/** @file softtimer.hpp
+ *  @brief Software timers driven by the Timer1 compare A interrupt.
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef SOFTTIMER_HPP
+#define SOFTTIMER_HPP
+
+#include <common.hpp>
+
+/** Number of buckets of the timer wheel (power of two), each bucket covers
+ *  one Timer1 overflow period (65536 ticks) */
+#ifndef SOFTTIMER_WHEEL_SIZE
+#define SOFTTIMER_WHEEL_SIZE 8
+#endif
+
+/** A one-shot or periodic software timer
+ *  The timers are based on Timer1::ticks() and do not use a fixed tick:
+ *  compare unit A of Timer1 is always programmed for the next deadline.
+ *  Timers expiring in the current overflow period are kept in a short sorted
+ *  list, all other timers are hashed into a wheel indexed by the overflow
+ *  period of their deadline. On every overflow, the timers of the new period
+ *  are moved from their bucket to the sorted list. Starting a timer due
+ *  in a later period and stopping a timer are O(1).
+ *
+ *  On expiry, the callback (if any) is invoked from the interrupt, and the
+ *  expiry count is incremented, @see expired. Periodic timers are
+ *  rescheduled relative to their previous deadline, hence do not drift.
+ *
+ *  Timer1 must be enabled with an internal clock before init() is called.
+ *  Deadlines are absolute Timer1::ticks() values: Timer1::restart() (also
+ *  called by Timer1::enable) moves the time base back to 0, after which
+ *  armed timers expire up to the elapsed time late. Stop and restart the
+ *  soft timers around a restart of Timer1, or do not restart Timer1.
+ *  CSoftTimer objects must outlive their active period (i.e. use static
+ *  or global instances).
+ *
+ *  Example:
+ *  @code
+ *  static CSoftTimer blink(toggleLed, 0);
+ *  Timer1::enable(Timer1::CLK_64);
+ *  CSoftTimer::init();
+ *  blink.startPeriodic(500000UL); // every 500 ms
+ *  @endcode
+ */
+class CSoftTimer {
+public:
+	/** Function called from the interrupt on expiry */
+	typedef void (*Callback)(void* arg);
+
+	/** Construct a timer
+	 * @param callback The function to call on expiry, or 0 to use the expiry flag only
+	 * @param arg The argument passed to the callback
+	 */
+	CSoftTimer(Callback callback = 0, void* arg = 0);
+
+	/** Enable the compare interrupt and install the overflow hook */
+	static void init();
+
+	/** Start (or restart) the timer to expire once
+	 * @param us The delay in microseconds
+	 */
+	void startOneShot(uint32_t us);
+
+	/** Start (or restart) the timer to expire periodically
+	 * @param us The period in microseconds
+	 */
+	void startPeriodic(uint32_t us);
+
+	/** Start (or restart) the timer
+	 * @param delay The delay until the first expiry in Timer1 ticks (less than 2^31)
+	 * @param period The period in Timer1 ticks, 0 for a one-shot timer
+	 */
+	void startTicks(uint32_t delay, uint32_t period);
+
+	/** Stop the timer, the expiry count is not cleared */
+	void stop();
+
+	/** Return whether the timer is scheduled */
+	bool active() const{ return m_pprev != 0; }
+
+	/** Return and clear the number of expiries since the last call
+	 * @return The number of expiries (saturates at 255)
+	 */
+	uint8_t expired();
+
+private:
+	CSoftTimer* m_next;      //!< Next timer in the same list
+	CSoftTimer** m_pprev;    //!< Pointer to the link pointing to this timer, 0 if inactive
+	uint32_t m_deadline;     //!< Expiry time in ticks
+	uint32_t m_period;       //!< Period in ticks, 0 for one-shot timers
+	Callback m_callback;     //!< The expiry callback
+	void* m_arg;             //!< The argument of the callback
+	volatile uint8_t m_fired; //!< Number of expiries not yet collected by expired()
+
+	void schedule(uint16_t period);
+	void unlink();
+
+	static void program();
+	static void dispatch();
+	static void overflow();
+
+	friend void _softTimerCompare();
+};
+
+#endif // SOFTTIMER_HPP
@@ -24,9 +24,39 @@ static inline uint16_t _getTimerPrescaleFactor(uint8_t TCCRxB){
 	return pgm_read_word(addr);
 }
 
+// log2 of the prescaling factors, for shift-based conversions
+static const int8_t prescalingShifts[] = {0, 0, 3, 6, 8, 10};
+
+#if CYCLES_PER_US == 16
+#  define CYCLES_PER_US_SHIFT 4
+#elif CYCLES_PER_US == 8
+#  define CYCLES_PER_US_SHIFT 3
+#elif CYCLES_PER_US == 1
+#  define CYCLES_PER_US_SHIFT 0
+#else
+#  error "Timer1::micros requires F_CPU to be a power of two MHz"
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 
-static volatile uint16_t timer1_overflow_count;
+static volatile uint32_t timer1_overflow_count;
+static uint16_t timer1_ticksPerMs = 1;
+static int8_t timer1_usShift; // micros = ticks << shift (shift >= 0) or ticks >> -shift
+static Timer1::OverflowHook timer1_overflowHook;
+
+// Reads the counter and the overflow count atomically
+static inline void _timer1Snapshot(uint16_t& tcnt, uint32_t& ovf)
+{
+	disable_interrupts;
+	tcnt = TCNT1;
+	ovf = timer1_overflow_count;
+	// An overflow occurred which was not yet serviced: if the counter value
+	// is small, it was read after the overflow
+	if(bit_is_set(TIFR1, TOV1) && tcnt < 0x8000){
+		++ovf;
+	}
+	restore_interrupts;
+}
 
 void Timer1::disable()
 {
@@ -38,6 +68,14 @@ void Timer1::enable(EClk prescaler)
 {
 	disable();
 	/* Wave generation mode is normal after reset (see tables 16-8, 17-2) */
+	/* Cache the conversion factors (external clocks count raw ticks) */
+	if(prescaler >= CLK_1 && prescaler <= CLK_1024){
+		timer1_ticksPerMs = F_CPU/(_getTimerPrescaleFactor(prescaler)*1000UL);
+		timer1_usShift = prescalingShifts[prescaler] - CYCLES_PER_US_SHIFT;
+	}else{
+		timer1_ticksPerMs = 1;
+		timer1_usShift = 0;
+	}
 	TCCR1B = (TCCR1B & ~TCCRxB_CS_MASK) | prescaler; /* Set prescaler */
 	sbi(TIMSK1, TOIE1);                             /* Enable overflow interrupt */
 	sei();
@@ -45,16 +83,63 @@ void Timer1::enable(EClk prescaler)
 }
 
 void Timer1::restart(){
-	timer1_overflow_count = TCNT1 = 0;
+	disable_interrupts;
+	TCNT1 = 0;
+	timer1_overflow_count = 0;
+	TIFR1 = _BV(TOV1); /* Clear pending overflow */
+	restore_interrupts;
+}
+
+uint32_t Timer1::elapsed(){
+	return ticks()/timer1_ticksPerMs;
+}
+
+uint32_t Timer1::ticks(){
+	uint16_t tcnt;
+	uint32_t ovf;
+	_timer1Snapshot(tcnt, ovf);
+	return (ovf << 16) | tcnt;
+}
+
+uint64_t Timer1::ticks64(){
+	uint16_t tcnt;
+	uint32_t ovf;
+	_timer1Snapshot(tcnt, ovf);
+	return (uint64_t(ovf) << 16) | tcnt;
+}
+
+uint32_t Timer1::micros(){
+	uint16_t tcnt;
+	uint32_t ovf;
+	_timer1Snapshot(tcnt, ovf);
+	int8_t shift = timer1_usShift;
+	// Shift both parts separately to avoid 48-bit arithmetic (65536 ticks are a whole number of us)
+	if(shift >= 0){
+		return (ovf << (16 + shift)) + (uint32_t(tcnt) << shift);
+	}
+	return (ovf << (16 + shift)) + (tcnt >> -shift);
+}
+
+uint32_t Timer1::ticksToMicros(uint32_t ticks){
+	int8_t shift = timer1_usShift;
+	return shift >= 0 ? ticks << shift : ticks >> -shift;
+}
+
+uint32_t Timer1::microsToTicks(uint32_t us){
+	int8_t shift = timer1_usShift;
+	return shift >= 0 ? us >> shift : us << -shift;
 }
 
-uint32_t Timer1::elapsed(){ // 16 bit
-	uint32_t ticks = TCNT1 + 65536*timer1_overflow_count;
-	uint32_t ticksPerMs = F_CPU/(_getTimerPrescaleFactor(TCCR1B)*1000);
-	return ticks/ticksPerMs;
+void Timer1::setOverflowHook(OverflowHook hook){
+	disable_interrupts;
+	timer1_overflowHook = hook;
+	restore_interrupts;
 }
 
 ISR(TIMER1_OVF_vect)
 {
 	++timer1_overflow_count;
+	if(timer1_overflowHook != 0){
+		timer1_overflowHook();
+	}
 }
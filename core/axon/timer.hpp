@@ -31,13 +31,60 @@ namespace Timer1 {
 	/** Disables the timer */
 	void disable();
 
-	/** Restarts the timer (the timer is expected to be enabled) */
+	/** Restarts the timer (the timer is expected to be enabled)
+	 *  The deadlines of armed CSoftTimer objects are not rebased, @see CSoftTimer
+	 */
 	void restart();
 
 	/** Return the elapsed time
 	 * @return The elapsed time in milliseconds
 	 */
 	uint32_t elapsed();
+
+	/** Return the number of timer ticks since the timer was (re)started
+	 *  The 16-bit counter is extended with the overflow count. The counter and
+	 *  overflow count are read atomically, and an overflow which occurred
+	 *  but was not yet serviced (i.e. because interrupts are disabled) is
+	 *  accounted for, such that the result is monotonic.
+	 * @return The low 32 bits of the tick count
+	 */
+	uint32_t ticks();
+
+	/** Return the number of timer ticks since the timer was (re)started
+	 * @see ticks
+	 * @return The 48-bit tick count
+	 */
+	uint64_t ticks64();
+
+	/** Return the elapsed time in microseconds
+	 *  For the internal clock prescalers, the ticks are converted with shifts
+	 *  only (F_CPU must be a power of two MHz). The result wraps around after
+	 *  2^32 microseconds (about 71 minutes), differences of two results are
+	 *  valid across the wrap-around.
+	 * @return The elapsed time in microseconds
+	 */
+	uint32_t micros();
+
+	/** Convert a number of ticks to microseconds, @see micros
+	 * @param ticks A number of ticks
+	 * @return The corresponding number of microseconds
+	 */
+	uint32_t ticksToMicros(uint32_t ticks);
+
+	/** Function called from the overflow interrupt, @see setOverflowHook */
+	typedef void (*OverflowHook)();
+
+	/** Install a function to be called from the overflow interrupt, after
+	 *  the overflow count was incremented (used by CSoftTimer)
+	 * @param hook The function, or 0 to remove the hook
+	 */
+	void setOverflowHook(OverflowHook hook);
+
+	/** Convert a number of microseconds to ticks, @see micros
+	 * @param us A number of microseconds
+	 * @return The corresponding number of ticks
+	 */
+	uint32_t microsToTicks(uint32_t us);
 }
 
 #endif
@@ -0,0 +1,65 @@
+/** @file timers.cpp
+ *  @brief Generic timer/counter driver for timers 0-5, see Atmega640 documentation chapters 16-20.
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "timers.hpp"
+
+static TimerCallback timer_callbacks[6][5];
+
+void _timerSetCallback(uint8_t timer, uint8_t irq, TimerCallback callback)
+{
+	disable_interrupts;
+	timer_callbacks[timer][irq] = callback;
+	restore_interrupts;
+}
+
+static inline void _timerDispatch(uint8_t timer, uint8_t irq)
+{
+	TimerCallback callback = timer_callbacks[timer][irq];
+	if(callback != 0){
+		callback();
+	}
+}
+
+// The handlers are weak, modules defining their own handler for a vector
+// (i.e. timer.cpp for TIMER1_OVF) take precedence.
+#define TIMER_ISR(vect, timer, irq) \
+	ISR(vect, __attribute__((weak))) \
+	{ \
+		_timerDispatch(timer, irq); \
+	}
+
+TIMER_ISR(TIMER0_OVF_vect,   0, TIMER_INT_OVF)
+TIMER_ISR(TIMER0_COMPA_vect, 0, TIMER_INT_COMPA)
+TIMER_ISR(TIMER0_COMPB_vect, 0, TIMER_INT_COMPB)
+
+TIMER_ISR(TIMER1_OVF_vect,   1, TIMER_INT_OVF)
+TIMER_ISR(TIMER1_COMPA_vect, 1, TIMER_INT_COMPA)
+TIMER_ISR(TIMER1_COMPB_vect, 1, TIMER_INT_COMPB)
+TIMER_ISR(TIMER1_COMPC_vect, 1, TIMER_INT_COMPC)
+TIMER_ISR(TIMER1_CAPT_vect,  1, TIMER_INT_CAPT)
+
+TIMER_ISR(TIMER2_OVF_vect,   2, TIMER_INT_OVF)
+TIMER_ISR(TIMER2_COMPA_vect, 2, TIMER_INT_COMPA)
+TIMER_ISR(TIMER2_COMPB_vect, 2, TIMER_INT_COMPB)
+
+TIMER_ISR(TIMER3_OVF_vect,   3, TIMER_INT_OVF)
+TIMER_ISR(TIMER3_COMPA_vect, 3, TIMER_INT_COMPA)
+TIMER_ISR(TIMER3_COMPB_vect, 3, TIMER_INT_COMPB)
+TIMER_ISR(TIMER3_COMPC_vect, 3, TIMER_INT_COMPC)
+TIMER_ISR(TIMER3_CAPT_vect,  3, TIMER_INT_CAPT)
+
+TIMER_ISR(TIMER4_OVF_vect,   4, TIMER_INT_OVF)
+TIMER_ISR(TIMER4_COMPA_vect, 4, TIMER_INT_COMPA)
+TIMER_ISR(TIMER4_COMPB_vect, 4, TIMER_INT_COMPB)
+TIMER_ISR(TIMER4_COMPC_vect, 4, TIMER_INT_COMPC)
+TIMER_ISR(TIMER4_CAPT_vect,  4, TIMER_INT_CAPT)
+
+TIMER_ISR(TIMER5_OVF_vect,   5, TIMER_INT_OVF)
+TIMER_ISR(TIMER5_COMPA_vect, 5, TIMER_INT_COMPA)
+TIMER_ISR(TIMER5_COMPB_vect, 5, TIMER_INT_COMPB)
+TIMER_ISR(TIMER5_COMPC_vect, 5, TIMER_INT_COMPC)
+TIMER_ISR(TIMER5_CAPT_vect,  5, TIMER_INT_CAPT)
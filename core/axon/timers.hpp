@@ -0,0 +1,278 @@
+/** @file timers.hpp
+ *  @brief Generic timer/counter driver for timers 0-5, see Atmega640 documentation chapters 16-20.
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef TIMERS_HPP
+#define TIMERS_HPP
+
+#include <common.hpp>
+
+/** Clock sources of timers 0, 1, 3, 4 and 5 */
+enum ETimerClock {
+	TIMER_CLK_STOP   = 0x00, //!< Timer stopped
+	TIMER_CLK_1      = 0x01, //!< Timer clocked at F_CPU
+	TIMER_CLK_8      = 0x02, //!< Timer clocked at F_CPU/8
+	TIMER_CLK_64     = 0x03, //!< Timer clocked at F_CPU/64
+	TIMER_CLK_256    = 0x04, //!< Timer clocked at F_CPU/256
+	TIMER_CLK_1024   = 0x05, //!< Timer clocked at F_CPU/1024
+	TIMER_CLK_T_FALL = 0x06, //!< Timer clocked at Tn falling edge
+	TIMER_CLK_T_RISE = 0x07  //!< Timer clocked at Tn rising edge
+};
+
+/** Clock sources of timer 2 (no external clock, more prescalers) */
+enum ETimer2Clock {
+	TIMER2_CLK_STOP = 0x00, //!< Timer stopped
+	TIMER2_CLK_1    = 0x01, //!< Timer clocked at F_CPU
+	TIMER2_CLK_8    = 0x02, //!< Timer clocked at F_CPU/8
+	TIMER2_CLK_32   = 0x03, //!< Timer clocked at F_CPU/32
+	TIMER2_CLK_64   = 0x04, //!< Timer clocked at F_CPU/64
+	TIMER2_CLK_128  = 0x05, //!< Timer clocked at F_CPU/128
+	TIMER2_CLK_256  = 0x06, //!< Timer clocked at F_CPU/256
+	TIMER2_CLK_1024 = 0x07  //!< Timer clocked at F_CPU/1024
+};
+
+/** Waveform generation modes of the 8-bit timers 0 and 2 (table 16-8) */
+enum ETimerMode8 {
+	TIMER8_NORMAL         = 0, //!< Normal, TOP = 0xFF
+	TIMER8_PWM_PC         = 1, //!< Phase correct PWM, TOP = 0xFF
+	TIMER8_CTC            = 2, //!< Clear timer on compare match, TOP = OCRA
+	TIMER8_FAST_PWM       = 3, //!< Fast PWM, TOP = 0xFF
+	TIMER8_PWM_PC_OCR     = 5, //!< Phase correct PWM, TOP = OCRA
+	TIMER8_FAST_PWM_OCR   = 7  //!< Fast PWM, TOP = OCRA
+};
+
+/** Waveform generation modes of the 16-bit timers 1, 3, 4 and 5 (table 17-2) */
+enum ETimerMode16 {
+	TIMER16_NORMAL        = 0,  //!< Normal, TOP = 0xFFFF
+	TIMER16_PWM_PC_8      = 1,  //!< Phase correct PWM, TOP = 0x00FF
+	TIMER16_PWM_PC_9      = 2,  //!< Phase correct PWM, TOP = 0x01FF
+	TIMER16_PWM_PC_10     = 3,  //!< Phase correct PWM, TOP = 0x03FF
+	TIMER16_CTC_OCR       = 4,  //!< Clear timer on compare match, TOP = OCRA
+	TIMER16_FAST_PWM_8    = 5,  //!< Fast PWM, TOP = 0x00FF
+	TIMER16_FAST_PWM_9    = 6,  //!< Fast PWM, TOP = 0x01FF
+	TIMER16_FAST_PWM_10   = 7,  //!< Fast PWM, TOP = 0x03FF
+	TIMER16_PWM_PFC_ICR   = 8,  //!< Phase and frequency correct PWM, TOP = ICR
+	TIMER16_PWM_PFC_OCR   = 9,  //!< Phase and frequency correct PWM, TOP = OCRA
+	TIMER16_PWM_PC_ICR    = 10, //!< Phase correct PWM, TOP = ICR
+	TIMER16_PWM_PC_OCR    = 11, //!< Phase correct PWM, TOP = OCRA
+	TIMER16_CTC_ICR       = 12, //!< Clear timer on compare match, TOP = ICR
+	TIMER16_FAST_PWM_ICR  = 14, //!< Fast PWM, TOP = ICR
+	TIMER16_FAST_PWM_OCR  = 15  //!< Fast PWM, TOP = OCRA
+};
+
+/** Compare output modes (tables 17-3 to 17-5) */
+enum ETimerOutput {
+	TIMER_OUT_DISCONNECTED = 0, //!< Normal port operation
+	TIMER_OUT_TOGGLE       = 1, //!< Toggle on compare match (non-PWM modes)
+	TIMER_OUT_CLEAR        = 2, //!< Clear on compare match (non-inverting PWM)
+	TIMER_OUT_SET          = 3  //!< Set on compare match (inverting PWM)
+};
+
+/** Compare channels */
+enum ETimerChannel { TIMER_CH_A = 0, TIMER_CH_B = 1, TIMER_CH_C = 2 };
+
+/** Timer interrupts */
+enum ETimerInterrupt {
+	TIMER_INT_OVF   = 0, //!< Overflow
+	TIMER_INT_COMPA = 1, //!< Compare match A
+	TIMER_INT_COMPB = 2, //!< Compare match B
+	TIMER_INT_COMPC = 3, //!< Compare match C (16-bit timers only)
+	TIMER_INT_CAPT  = 4  //!< Input capture (16-bit timers only)
+};
+
+/** Function called from a timer interrupt */
+typedef void (*TimerCallback)();
+
+/** Installs a callback in the dispatch table, @see Timer::setCallback */
+void _timerSetCallback(uint8_t timer, uint8_t irq, TimerCallback callback);
+
+/** Register accessors of a timer, resolved at compile time */
+template<uint8_t N> struct TimerRegs;
+
+#define TIMER_DEFINE_REGS8(n) \
+	template<> struct TimerRegs<n> { \
+		typedef uint8_t value_t; \
+		static const bool WIDE = false; \
+		static sfr8_t TCCRA(){ return TCCR##n##A; } \
+		static sfr8_t TCCRB(){ return TCCR##n##B; } \
+		static sfr8_t TCNT(){ return TCNT##n; } \
+		static sfr8_t OCR(uint8_t ch){ return ch == TIMER_CH_A ? OCR##n##A : OCR##n##B; } \
+		static sfr8_t TIMSK(){ return TIMSK##n; } \
+		static sfr8_t TIFR(){ return TIFR##n; } \
+	}
+
+#define TIMER_DEFINE_REGS16(n) \
+	template<> struct TimerRegs<n> { \
+		typedef uint16_t value_t; \
+		static const bool WIDE = true; \
+		static sfr8_t TCCRA(){ return TCCR##n##A; } \
+		static sfr8_t TCCRB(){ return TCCR##n##B; } \
+		static sfr16_t TCNT(){ return TCNT##n; } \
+		static sfr16_t OCR(uint8_t ch){ return ch == TIMER_CH_A ? OCR##n##A : ch == TIMER_CH_B ? OCR##n##B : OCR##n##C; } \
+		static sfr16_t ICR(){ return ICR##n; } \
+		static sfr8_t TIMSK(){ return TIMSK##n; } \
+		static sfr8_t TIFR(){ return TIFR##n; } \
+	}
+
+TIMER_DEFINE_REGS8(0);
+TIMER_DEFINE_REGS16(1);
+TIMER_DEFINE_REGS8(2);
+TIMER_DEFINE_REGS16(3);
+TIMER_DEFINE_REGS16(4);
+TIMER_DEFINE_REGS16(5);
+
+#undef TIMER_DEFINE_REGS8
+#undef TIMER_DEFINE_REGS16
+
+/** Generic timer/counter driver
+ *  All functions are static and inline, the register addresses are
+ *  constants of the template argument. Accesses to the 16-bit registers
+ *  are done with interrupts disabled (they share the TEMP register).
+ *
+ *  The interrupts dispatch to the callbacks installed with setCallback.
+ *  The interrupt handlers are weak symbols, so that modules which need
+ *  a dedicated handler can replace them. Allocation of the timers:
+ *  - Timer 0: A2D::startSampling (CTC, compare A triggers the conversions)
+ *  - Timer 1: Timer1 clock (overflow) and CSoftTimer (compare A); the
+ *             callbacks of these two interrupts are not used
+ *  - Timer 3, 4: PWM (overflow callbacks during PWM::commit)
+ *  - Timer 5: Profiler (if PROFILING is defined) or ServoMux (compare A)
+ *  - Timer 2: PCProf (dedicated compare A handler)
+ *
+ *  Example:
+ *  @code
+ *  // 1 kHz interrupt on timer 2
+ *  Timer<2>::setCompare(TIMER_CH_A, 249);
+ *  Timer<2>::setCallback(TIMER_INT_COMPA, tick);
+ *  Timer<2>::enable(TIMER8_CTC, TIMER2_CLK_64);
+ *  @endcode
+ */
+template<uint8_t N>
+class Timer {
+	typedef TimerRegs<N> R;
+
+public:
+	typedef typename R::value_t value_t;
+
+	/** Set the waveform generation mode and start the timer
+	 * @param mode The waveform mode, @see ETimerMode8, ETimerMode16
+	 * @param clock The clock source, @see ETimerClock, ETimer2Clock
+	 */
+	static void enable(uint8_t mode, uint8_t clock){
+		setMode(mode);
+		setClock(clock);
+	}
+
+	/** Stop the timer and disable its interrupts */
+	static void disable(){
+		setClock(0);
+		R::TIMSK() = 0x00;
+		R::TIFR() = 0xFF; /* Clear pending flags */
+	}
+
+	/** Set the clock source, TIMER_CLK_STOP (0) stops the timer */
+	static void setClock(uint8_t clock){
+		R::TCCRB() = (R::TCCRB() & ~0x07) | (clock & 0x07);
+	}
+
+	/** Set the waveform generation mode */
+	static void setMode(uint8_t mode){
+		R::TCCRA() = (R::TCCRA() & ~0x03) | (mode & 0x03);
+		R::TCCRB() = (R::TCCRB() & ~0x18) | ((mode & 0x0C) << 1);
+	}
+
+	/** Set the compare output mode of a channel (the pin must be an output) */
+	static void setOutput(ETimerChannel ch, ETimerOutput mode){
+		uint8_t shift = 6 - 2*ch;
+		R::TCCRA() = (R::TCCRA() & ~(0x03 << shift)) | (mode << shift);
+	}
+
+	/** Return the counter value */
+	static value_t count(){
+		disable_interrupts;
+		value_t value = R::TCNT();
+		restore_interrupts;
+		return value;
+	}
+
+	/** Set the counter value */
+	static void setCount(value_t value){
+		disable_interrupts;
+		R::TCNT() = value;
+		restore_interrupts;
+	}
+
+	/** Return the compare value of a channel */
+	static value_t compare(ETimerChannel ch){
+		disable_interrupts;
+		value_t value = R::OCR(ch);
+		restore_interrupts;
+		return value;
+	}
+
+	/** Set the compare value of a channel (double buffered in PWM modes) */
+	static void setCompare(ETimerChannel ch, value_t value){
+		disable_interrupts;
+		R::OCR(ch) = value;
+		restore_interrupts;
+	}
+
+	/** Set the input capture register, used as TOP by the ICR modes (16-bit timers only) */
+	static void setTop(uint16_t value){
+		disable_interrupts;
+		R::ICR() = value;
+		restore_interrupts;
+	}
+
+	/** Return the input capture register (16-bit timers only) */
+	static uint16_t capture(){
+		disable_interrupts;
+		uint16_t value = R::ICR();
+		restore_interrupts;
+		return value;
+	}
+
+	/** Configure the input capture unit (16-bit timers only)
+	 * @param rising Capture on the rising (true) or falling (false) edge
+	 * @param noiseCanceler Whether to filter the input over four samples
+	 */
+	static void setCapture(bool rising, bool noiseCanceler){
+		R::TCCRB() = (R::TCCRB() & ~0xC0) | (noiseCanceler << 7) | (rising << 6);
+	}
+
+	/** Toggle the input capture edge (16-bit timers only) */
+	static void toggleCaptureEdge(){
+		R::TCCRB() ^= 0x40;
+	}
+
+	/** Install a callback for an interrupt and enable the interrupt
+	 * @param irq The interrupt, @see ETimerInterrupt
+	 * @param callback The callback, 0 disables the interrupt
+	 */
+	static void setCallback(ETimerInterrupt irq, TimerCallback callback){
+		disableInterrupt(irq);
+		_timerSetCallback(N, irq, callback);
+		if(callback != 0){
+			clearFlag(irq);
+			enableInterrupt(irq);
+		}
+	}
+
+	/** Enable an interrupt */
+	static void enableInterrupt(ETimerInterrupt irq){ R::TIMSK() |= mask(irq); }
+
+	/** Disable an interrupt */
+	static void disableInterrupt(ETimerInterrupt irq){ R::TIMSK() &= ~mask(irq); }
+
+	/** Clear the pending flag of an interrupt */
+	static void clearFlag(ETimerInterrupt irq){ R::TIFR() = mask(irq); }
+
+private:
+	// Bit of the interrupt in TIMSKn and TIFRn
+	static uint8_t mask(ETimerInterrupt irq){ return irq == TIMER_INT_CAPT ? _BV(5) : _BV(irq); }
+};
+
+#endif // TIMERS_HPP
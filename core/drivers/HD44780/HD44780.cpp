@@ -91,6 +91,37 @@ void HD44780::pulseEnable()
 	_delay_us(10);
 }
 
+uint8_t HD44780::sendAsync(PT* pt, uint8_t value, bool data)
+{
+	PT_BEGIN(pt);
+	if(data){
+		sbi(CTRL_PORT, RS_PIN);
+	}else{
+		cbi(CTRL_PORT, RS_PIN);
+	}
+	DATA_PORT = value;
+	// Same timings as pulseEnable and waitForReady
+	PT_WAIT_US(pt, 40);
+	sbi(CTRL_PORT, E_PIN);
+	PT_WAIT_US(pt, 230);
+	cbi(CTRL_PORT, E_PIN);
+	PT_WAIT_US(pt, 50);
+	if(!data && value <= 0x03){
+		// Clear display and return home
+		PT_WAIT_MS(pt, 2);
+	}
+	PT_END(pt);
+}
+
+uint8_t HD44780::writeStringAsync(PT* pt, const char* str)
+{
+	PT_BEGIN(pt);
+	for(m_asyncIndex = 0; str[m_asyncIndex] != '\0'; ++m_asyncIndex){
+		PT_SPAWN(pt, &m_asyncChild, sendAsync(&m_asyncChild, str[m_asyncIndex], true));
+	}
+	PT_END(pt);
+}
+
 void HD44780::waitForReady()
 {
 	// http://electronics.stackexchange.com/questions/26120/hd44780-how-long-do-i-have-to-wait-for-busy-flag-to-reset
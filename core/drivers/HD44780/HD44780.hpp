@@ -9,6 +9,7 @@
 #define HD44780_HPP
 
 #include <common.hpp>
+#include <utils/pt.hpp>
 
 /** Driver for HD44780 OLED LCD controllers */
 class HD44780 {
@@ -213,7 +214,31 @@ public:
 	 * @param data The graphic data array.
 	 */
 	void setGraphicsData(uint8_t (&data)[100][2]);
-  
+
+	/** Non-blocking variant of send_command/send_data
+	 * This is a protothread (@see pt.hpp): call it repeatedly with the same
+	 * arguments until it returns PT_ENDED. Instead of busy-waiting, it
+	 * returns while waiting for the enable pulse timings and the command
+	 * execution time (including the 2 ms of clear display and return home).
+	 * Timer1 must be enabled. Do not interleave with the blocking functions.
+	 *
+	 * @param pt The protothread state, initialized with PT_INIT
+	 * @param value The command or data byte
+	 * @param data Whether value is a data byte (true) or a command (false)
+	 * @return PT_WAITING while busy, PT_ENDED when done
+	 */
+	uint8_t sendAsync(PT* pt, uint8_t value, bool data);
+
+	/** Non-blocking write of a string at the current position
+	 * See sendAsync, the string must remain valid and unchanged until the
+	 * function returns PT_ENDED.
+	 *
+	 * @param pt The protothread state, initialized with PT_INIT
+	 * @param str The NUL-terminated string
+	 * @return PT_WAITING while busy, PT_ENDED when done
+	 */
+	uint8_t writeStringAsync(PT* pt, const char* str);
+
 private:
 	sfr8_t DATA_DDR;
 	sfr8_t DATA_PORT;
@@ -224,6 +249,9 @@ private:
 	void send_data(uint8_t data);
 	void pulseEnable();
 	void waitForReady();
+
+	PT m_asyncChild;      // State of sendAsync when spawned by writeStringAsync
+	uint8_t m_asyncIndex; // Position in the string of writeStringAsync
 };
 
 #endif // HD44780_HPP
@@ -196,8 +196,8 @@ inline void ILI9325::rotatePixel(uint16_t x0, uint16_t y0, uint16_t& x, uint16_t
 }
 
 /** Public api functions **/
-ILI9325::ILI9325(sfr8_t _CTRL_DDR, sfr8_t _DATA_DDR, sfr8_t _CTRL_PORT, sfr8_t _DATA_PORT, ERot rot)
-	: CTRL_PORT(_CTRL_PORT), DATA_PORT(_DATA_PORT)
+ILI9325::ILI9325(sfr8_t _CTRL_DDR, sfr8_t _DATA_DDR, sfr8_t _CTRL_PORT, sfr8_t _DATA_PORT, ERot rot, bool init)
+	: m_rotation(rot), CTRL_PORT(_CTRL_PORT), DATA_PORT(_DATA_PORT)
 {
 	// Control port as output port, set all pins to high
 	set_bits(_CTRL_DDR, 0xFF, LCD_CTRL_MASK);
@@ -207,6 +207,10 @@ ILI9325::ILI9325(sfr8_t _CTRL_DDR, sfr8_t _DATA_DDR, sfr8_t _CTRL_PORT, sfr8_t _
 	_DATA_DDR = 0xFF;
 	_DATA_PORT = 0x00;
 
+	if(!init){
+		return;
+	}
+
 	// Initialization procedure
 	reset();
 
@@ -235,6 +239,31 @@ void ILI9325::reset()
 	_delay_ms(100);
 }
 
+uint8_t ILI9325::initialize(PT* pt)
+{
+	uint16_t cmd, data; // Not preserved across waits
+	PT_BEGIN(pt);
+	cbi(CTRL_PORT, LCD_RST);
+	PT_WAIT_MS(pt, 10);
+	sbi(CTRL_PORT, LCD_RST);
+	PT_WAIT_MS(pt, 100);
+
+	for(m_initIndex = 0; m_initIndex < sizeof(ILI932x_regValues)/(2*sizeof(uint16_t)); ++m_initIndex){
+		cmd = pgm_read_word(ILI932x_regValues + m_initIndex*2);
+		data = pgm_read_word(ILI932x_regValues + m_initIndex*2 + 1);
+
+		if(cmd == TFTLCD_DELAY50 || cmd == TFTLCD_DELAY200){
+			PT_WAIT_MS(pt, data);
+		}else{
+			writeReg(cmd, data);
+		}
+	}
+
+	setRotation(m_rotation);
+	fillScreen(rgbTo565(255, 255, 255));
+	PT_END(pt);
+}
+
 void ILI9325::setRotation(ERot rot)
 {
 	m_rotation = rot;
@@ -9,6 +9,7 @@
 #define ILI9325_HPP
 
 #include <common.hpp>
+#include <utils/pt.hpp>
 #include <avr/pgmspace.h>
 #include <stdio.h>
 
@@ -48,6 +49,7 @@ private:
 
 	uint16_t m_HorEntryMode, m_VerEntryMode;
 	ERot m_rotation;
+	uint8_t m_initIndex;
 	sfr8_t CTRL_PORT;
 	sfr8_t DATA_PORT;
 
@@ -74,12 +76,24 @@ public:
 	 * @param _DATA_PORT The port to which the data pins are connected.
 	 *                   The pins 0-7 must be connected to (in order) D0-D7
 	 * @param rot The rotation
+	 * @param init Whether to run the initialization procedure (blocks for
+	 *             more than 600 ms). If false, call initialize until it
+	 *             returns PT_ENDED before using the display.
 	 */
-	ILI9325(sfr8_t _CTRL_DDR, sfr8_t _DATA_DDR, sfr8_t _CTRL_PORT, sfr8_t _DATA_PORT, ERot rot = ROT_0);
+	ILI9325(sfr8_t _CTRL_DDR, sfr8_t _DATA_DDR, sfr8_t _CTRL_PORT, sfr8_t _DATA_PORT, ERot rot = ROT_0, bool init = true);
 
 	/** Resets the LCD display */
 	void reset();
 
+	/** Non-blocking reset and initialization procedure
+	 * This is a protothread (@see pt.hpp): call it repeatedly until it
+	 * returns PT_ENDED, it returns instead of waiting during the reset and
+	 * power-up delays. Timer1 must be enabled.
+	 * @param pt The protothread state, initialized with PT_INIT
+	 * @return PT_WAITING while busy, PT_ENDED when done
+	 */
+	uint8_t initialize(PT* pt);
+
 	/** Sets the LCD rotation
 	 * @param rot A rotation, @see ERot
 	 */
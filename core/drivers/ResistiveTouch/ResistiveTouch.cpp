@@ -0,0 +1,197 @@
+/** @file ResistiveTouch.cpp
+ *  @brief Driver for 4-wire resistive touch panels
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "ResistiveTouch.hpp"
+#include <axon/a2d.hpp>
+#include <utils/filter.hpp>
+#include <stdlib.h>
+
+// Measurement sequence: three X samples, three Y samples, Z1 and Z2
+#define TOUCH_SAMPLES 8
+#define TOUCH_Z1      6
+#define TOUCH_Z2      7
+
+// Calibration bounds (exclusive): |a*x| + |b*y| + |c| < 2^31 for 10-bit x and y
+#define TOUCH_CAL_MAX_AB (1L << 19)
+#define TOUCH_CAL_MAX_C  (1L << 29)
+
+#if 2 * 1023 * (TOUCH_CAL_MAX_AB - 1) + (TOUCH_CAL_MAX_C - 1) > 0x7FFFFFFFL
+#  error "The calibration bounds allow the transform to overflow 32 bits"
+#endif
+
+static const uint8_t touch_drive[TOUCH_SAMPLES] = { 1, 1, 1, 2, 2, 2, 3, 3 }; // EDrive per sample
+
+static inline void _pinOut(const ResistiveTouch::Pin& pin, bool high)
+{
+	if(high){
+		sbi(pin.PORT, pin.bit);
+	}else{
+		cbi(pin.PORT, pin.bit);
+	}
+	sbi(pin.DDR, pin.bit);
+}
+
+static inline void _pinHiZ(const ResistiveTouch::Pin& pin)
+{
+	cbi(pin.DDR, pin.bit);
+	cbi(pin.PORT, pin.bit); // No pull-up
+}
+
+ResistiveTouch::ResistiveTouch(const Pin& xp, const Pin& xm, const Pin& yp, const Pin& ym,
+                               uint8_t xmChannel, uint8_t ypChannel, CRingBuffer<Event>& events)
+	: m_xp(xp), m_xm(xm), m_yp(yp), m_ym(ym), m_xmChannel(xmChannel), m_ypChannel(ypChannel),
+	  m_events(events), m_threshold(100), m_step(0), m_drive(DRIVE_NONE), m_converting(false),
+	  m_touched(false), m_debounce(2), m_count(0), m_moveThreshold(2)
+{
+	Calibration identity = {1, 0, 0, 0, 1, 0, 1};
+	m_cal = identity;
+	m_raw.x = m_raw.y = 0;
+	m_last.type = EVENT_RELEASE;
+	m_last.x = m_last.y = 0;
+	m_last.pressure = 0;
+	m_reported.x = m_reported.y = 0;
+	drive(DRIVE_X);
+}
+
+void ResistiveTouch::setCalibration(const Calibration& cal)
+{
+	disable_interrupts;
+	m_cal = cal;
+	restore_interrupts;
+}
+
+void ResistiveTouch::drive(uint8_t mode)
+{
+	m_drive = mode;
+	if(mode == DRIVE_X){
+		// X+ high, X- low, measure the voltage on Y+
+		_pinHiZ(m_yp);
+		_pinHiZ(m_ym);
+		_pinOut(m_xp, true);
+		_pinOut(m_xm, false);
+	}else if(mode == DRIVE_Y){
+		// Y+ high, Y- low, measure the voltage on X-
+		_pinHiZ(m_xp);
+		_pinHiZ(m_xm);
+		_pinOut(m_yp, true);
+		_pinOut(m_ym, false);
+	}else{
+		// X+ low, Y- high, measure Z1 on X- and Z2 on Y+
+		_pinHiZ(m_xm);
+		_pinHiZ(m_yp);
+		_pinOut(m_xp, false);
+		_pinOut(m_ym, true);
+	}
+}
+
+void ResistiveTouch::service()
+{
+	if(m_converting){
+		if(!A2D::conversionComplete()){
+			return;
+		}
+		m_samples[m_step] = A2D::conversionResult();
+		m_converting = false;
+		if(++m_step == TOUCH_SAMPLES){
+			m_step = 0;
+			measurementDone();
+		}
+	}
+	// Switching the drive takes one step, to let the panel settle
+	uint8_t mode = touch_drive[m_step];
+	if(mode != m_drive){
+		drive(mode);
+		return;
+	}
+	uint8_t ch = (mode == DRIVE_X || m_step == TOUCH_Z2) ? m_ypChannel : m_xmChannel;
+	A2D::startConversion(ch);
+	m_converting = true;
+}
+
+void ResistiveTouch::measurementDone()
+{
+	int16_t z1 = m_samples[TOUCH_Z1];
+	int16_t z2 = m_samples[TOUCH_Z2];
+	int16_t pressure = 1023 - (z2 - z1);
+	bool touched = z1 > 0 && pressure > int16_t(m_threshold);
+
+	if(touched){
+		m_raw.x = Filter::median3(m_samples);
+		m_raw.y = Filter::median3(m_samples + 3);
+		const Calibration& c = m_cal;
+		m_last.x = (c.a * m_raw.x + c.b * m_raw.y + c.c) / c.div;
+		m_last.y = (c.d * m_raw.x + c.e * m_raw.y + c.f) / c.div;
+		m_last.pressure = pressure;
+	}
+
+	// Debounce: the state must persist for m_debounce measurements
+	if(touched == m_touched){
+		m_count = 0;
+		// Only report moves beyond the threshold, not the noise of a resting touch
+		if(touched && (abs(m_last.x - m_reported.x) > m_moveThreshold ||
+		               abs(m_last.y - m_reported.y) > m_moveThreshold)){
+			pushEvent(EVENT_MOVE);
+		}
+	}else if(++m_count >= m_debounce){
+		m_count = 0;
+		m_touched = touched;
+		pushEvent(touched ? EVENT_PRESS : EVENT_RELEASE);
+	}
+}
+
+void ResistiveTouch::pushEvent(uint8_t type)
+{
+	m_last.type = type;
+	m_reported.x = m_last.x;
+	m_reported.y = m_last.y;
+	m_events.push(m_last);
+}
+
+static inline int64_t _abs64(int64_t v)
+{
+	return v < 0 ? -v : v;
+}
+
+bool ResistiveTouch::computeCalibration(const Point display[3], const Point touch[3], Calibration& cal)
+{
+	// See Vidales, "How To Calibrate Touch Screens", Embedded Systems Programming 2002
+	// The terms c and f are products of three coordinates, hence 64-bit
+	int64_t x0 = touch[0].x, x1 = touch[1].x, x2 = touch[2].x;
+	int64_t y0 = touch[0].y, y1 = touch[1].y, y2 = touch[2].y;
+	int64_t X0 = display[0].x, X1 = display[1].x, X2 = display[2].x;
+	int64_t Y0 = display[0].y, Y1 = display[1].y, Y2 = display[2].y;
+	int64_t m[7];
+	m[6] = (x0 - x2) * (y1 - y2) - (x1 - x2) * (y0 - y2);
+	if(m[6] == 0){
+		return false;
+	}
+	m[0] = (X0 - X2) * (y1 - y2) - (X1 - X2) * (y0 - y2);
+	m[1] = (x0 - x2) * (X1 - X2) - (X0 - X2) * (x1 - x2);
+	m[2] = y0 * (x2 * X1 - x1 * X2) + y1 * (x0 * X2 - x2 * X0) + y2 * (x1 * X0 - x0 * X1);
+	m[3] = (Y0 - Y2) * (y1 - y2) - (Y1 - Y2) * (y0 - y2);
+	m[4] = (x0 - x2) * (Y1 - Y2) - (Y0 - Y2) * (x1 - x2);
+	m[5] = y0 * (x2 * Y1 - x1 * Y2) + y1 * (x0 * Y2 - x2 * Y0) + y2 * (x1 * Y0 - x0 * Y1);
+	// Scale the matrix down until the transform cannot overflow 32 bits
+	while(_abs64(m[0]) >= TOUCH_CAL_MAX_AB || _abs64(m[1]) >= TOUCH_CAL_MAX_AB ||
+	      _abs64(m[3]) >= TOUCH_CAL_MAX_AB || _abs64(m[4]) >= TOUCH_CAL_MAX_AB ||
+	      _abs64(m[2]) >= TOUCH_CAL_MAX_C || _abs64(m[5]) >= TOUCH_CAL_MAX_C){
+		for(uint8_t i = 0; i < 7; ++i){
+			m[i] /= 2;
+		}
+	}
+	if(m[6] == 0){
+		return false;
+	}
+	cal.a = m[0];
+	cal.b = m[1];
+	cal.c = m[2];
+	cal.d = m[3];
+	cal.e = m[4];
+	cal.f = m[5];
+	cal.div = m[6];
+	return true;
+}
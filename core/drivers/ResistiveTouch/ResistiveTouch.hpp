@@ -0,0 +1,159 @@
+/** @file ResistiveTouch.hpp
+ *  @brief Driver for 4-wire resistive touch panels
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef RESISTIVETOUCH_HPP
+#define RESISTIVETOUCH_HPP
+
+#include <common.hpp>
+#include <axon/ringbuffer.hpp>
+
+/** Driver for 4-wire resistive touch panels
+ * The panel is read with a non-blocking state machine which advances by one
+ * step each time service is called, i.e. from a 1 kHz timer interrupt. One
+ * step either switches the panel drive, or collects the previous conversion
+ * and starts the next one, so a step never waits for the A2D converter.
+ * A full measurement (3 samples per axis, 2 pressure samples) takes 11 steps.
+ * The medians of the axis samples are transformed to display coordinates by
+ * a fixed-point calibration matrix, and debounced touch events are written
+ * to an event buffer.
+ *
+ * Pin requirements:
+ * - Y+ and X- must be connected to A2D inputs
+ * - X+ and Y- may be connected to any GIO
+ * - The A2D converter must be initialized (@see A2D::init) and must not be
+ *   used by other code while service may run
+ *
+ * Example:
+ * @code{.cpp}
+ *   static ResistiveTouch::Event events[8];
+ *   CRingBuffer<ResistiveTouch::Event> eventBuffer(events, 8);
+ *   ResistiveTouch::Pin xp = {DDRB, PORTB, 4}, ym = {DDRB, PORTB, 5};
+ *   ResistiveTouch::Pin yp = {DDRF, PORTF, 1}, xm = {DDRF, PORTF, 2};
+ *   ResistiveTouch touch(xp, xm, yp, ym, A2D::CH_2, A2D::CH_1, eventBuffer);
+ *   // In a 1 kHz timer interrupt:
+ *   touch.service();
+ *   // In the main loop:
+ *   ResistiveTouch::Event ev;
+ *   while(eventBuffer.pop(ev)){ ... }
+ * @endcode
+ */
+class ResistiveTouch {
+public:
+	/** A panel pin */
+	struct Pin {
+		sfr8_t DDR;  //!< The data direction register of the pin
+		sfr8_t PORT; //!< The port register of the pin
+		uint8_t bit; //!< The bit of the pin
+	};
+
+	/** A point */
+	struct Point {
+		int16_t x, y;
+	};
+
+	/** Calibration matrix
+	 * display.x = (a*touch.x + b*touch.y + c) / div
+	 * display.y = (d*touch.x + e*touch.y + f) / div
+	 * The numerators are evaluated in 32 bits: |a|, |b|, |d|, |e| must be
+	 * below 2^19 and |c|, |f| below 2^29, as returned by computeCalibration.
+	 */
+	struct Calibration {
+		int32_t a, b, c, d, e, f, div;
+	};
+
+	/** Touch event types */
+	enum EEventType { EVENT_PRESS = 0, EVENT_MOVE = 1, EVENT_RELEASE = 2 };
+
+	/** A touch event */
+	struct Event {
+		uint8_t type;      //!< The event type, @see EEventType
+		int16_t x, y;      //!< The display coordinates (last position for EVENT_RELEASE)
+		uint16_t pressure; //!< The pressure, larger values are harder touches
+	};
+
+	/**
+	 * @param xp The X+ pin
+	 * @param xm The X- pin
+	 * @param yp The Y+ pin
+	 * @param ym The Y- pin
+	 * @param xmChannel The A2D channel of the X- pin
+	 * @param ypChannel The A2D channel of the Y+ pin
+	 * @param events The buffer to which the touch events are written
+	 */
+	ResistiveTouch(const Pin& xp, const Pin& xm, const Pin& yp, const Pin& ym,
+	               uint8_t xmChannel, uint8_t ypChannel, CRingBuffer<Event>& events);
+
+	/** Advances the measurement state machine by one step
+	 * To be called periodically, i.e. from a timer interrupt at about 1 kHz.
+	 */
+	void service();
+
+	/** Sets the calibration matrix
+	 * Defaults to the identity (raw 10-bit panel coordinates).
+	 * @param cal The calibration matrix, @see computeCalibration
+	 */
+	void setCalibration(const Calibration& cal);
+
+	/** Sets the pressure threshold above which the panel is considered touched
+	 * @param pressure The threshold, defaults to 100
+	 */
+	void setPressureThreshold(uint16_t pressure){ m_threshold = pressure; }
+
+	/** Sets the number of consecutive measurements required to report a press or release
+	 * @param count The debounce count, defaults to 2
+	 */
+	void setDebounce(uint8_t count){ m_debounce = count; }
+
+	/** Sets the distance a touch must move to report an EVENT_MOVE
+	 * A move is reported when x or y differ from the last reported event by
+	 * more than the threshold, which suppresses the noise of a resting touch.
+	 * @param distance The threshold in display units, defaults to 2
+	 */
+	void setMoveThreshold(uint8_t distance){ m_moveThreshold = distance; }
+
+	/** Returns the raw (uncalibrated) panel coordinates of the last measurement */
+	Point raw() const{ return m_raw; }
+
+	/** Computes the calibration matrix from three non-colinear reference points
+	 * @param display The display coordinates of the reference points
+	 * @param touch The raw panel coordinates measured at the reference points, @see raw
+	 * @param cal The computed calibration matrix
+	 * The matrix is scaled down to the bounds given at @see Calibration.
+	 * @return false if the points are colinear, true otherwise
+	 */
+	static bool computeCalibration(const Point display[3], const Point touch[3], Calibration& cal);
+
+private:
+	enum EDrive { DRIVE_NONE, DRIVE_X, DRIVE_Y, DRIVE_Z };
+
+	void drive(uint8_t mode);
+	void measurementDone();
+	void pushEvent(uint8_t type);
+
+	const Pin m_xp;
+	const Pin m_xm;
+	const Pin m_yp;
+	const Pin m_ym;
+	uint8_t m_xmChannel, m_ypChannel;
+	CRingBuffer<Event>& m_events;
+
+	Calibration m_cal;
+	int16_t m_samples[8];
+	Point m_raw;
+	Event m_last;
+	Point m_reported;
+	uint16_t m_threshold;
+	uint8_t m_step;
+	uint8_t m_drive;
+	bool m_converting;
+	bool m_touched;
+	uint8_t m_debounce;
+	uint8_t m_count;
+	uint8_t m_moveThreshold;
+};
+
+#endif // RESISTIVETOUCH_HPP
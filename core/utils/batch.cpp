@@ -0,0 +1,68 @@
+/** @file batch.cpp
+ *  @brief Utility class for batching samples into a single message
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "batch.hpp"
+#include "message.hpp"
+#include <axon/timer.hpp>
+#include <string.h>
+
+MessageBatch::MessageBatch(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId,
+                           uint8_t sampleSize, uint8_t* buffer, uint16_t bufSize, uint16_t timeout)
+	: m_uart(uart), m_sig(sig), m_buffer(buffer), m_length(HEADER_SIZE), m_bufSize(bufSize),
+	  m_timeout(timeout), m_dropped(0), m_sampleSize(sampleSize)
+{
+	// Header: [CLASS:1 ID:1 LENGTH:2 COUNT:1 TIMESTAMP:4]
+	m_buffer[0] = msgClass;
+	m_buffer[1] = msgId;
+	m_buffer[4] = 0;
+}
+
+void MessageBatch::add(const void* sample)
+{
+	append((const uint8_t*)sample, m_sampleSize);
+}
+
+void MessageBatch::append(const uint8_t* data, uint8_t len)
+{
+	if(m_length + len > m_bufSize){
+		flush();
+	}
+	if(m_buffer[4] == 0){
+		*(uint32_t*)(m_buffer+5) = Timer1::elapsed();
+	}
+	memcpy(m_buffer + m_length, data, len);
+	m_length += len;
+	++m_buffer[4];
+	// Send if there is no room for another sample
+	if(m_length + m_sampleSize > m_bufSize || m_buffer[4] == 0xFF){
+		flush();
+	}
+}
+
+void MessageBatch::service()
+{
+	if(m_timeout != 0 && m_buffer[4] != 0 && Timer1::elapsed() - *(uint32_t*)(m_buffer+5) >= m_timeout){
+		flush();
+	}
+}
+
+bool MessageBatch::flush()
+{
+	if(m_buffer[4] == 0){
+		return true;
+	}
+	bool success = Message::canSend(m_uart, m_length);
+	if(success){
+		*(uint16_t*)(m_buffer+2) = m_length - 4;
+		Message::send(m_uart, m_sig, m_buffer, m_length);
+	}else{
+		m_dropped += m_buffer[4];
+	}
+	m_length = HEADER_SIZE;
+	m_buffer[4] = 0;
+	return success;
+}
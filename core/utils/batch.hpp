@@ -0,0 +1,109 @@
+/** @file batch.hpp
+ *  @brief Utility class for batching samples into a single message
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <common.hpp>
+
+class UART;
+
+/** Collects samples of a fixed size into a single message of the form
+ * [SIG:2 CLASS:1 ID:1 LENGTH:2 COUNT:1 TIMESTAMP:4 SAMPLES:COUNT*SAMPLESIZE CHECKSUM:2]
+ * TIMESTAMP is the time (in milliseconds, @see Timer1::elapsed) at which the
+ * first sample of the batch was added. Timer1 must be enabled.
+ * The batch is sent when it is full, when the deadline has passed (@see service)
+ * or when flush is called. Variable-length records, which are counted like
+ * samples, are added with append.
+ * @see TypedMessageBatch, delta.hpp
+ */
+class MessageBatch {
+public:
+	/** Size of the batch header (CLASS, ID, LENGTH, COUNT, TIMESTAMP) */
+	static const uint8_t HEADER_SIZE = 9;
+
+	/**
+	 * @param uart       The uart port
+	 * @param sig        The message start signature
+	 * @param msgClass   The message class
+	 * @param msgId      The message id
+	 * @param sampleSize The size of a single sample in bytes
+	 * @param buffer     The message buffer, must be at least HEADER_SIZE + sampleSize bytes large
+	 * @param bufSize    The size of the message buffer
+	 * @param timeout    The maximum time in milliseconds a sample is held back, 0 to disable
+	 */
+	MessageBatch(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId,
+	             uint8_t sampleSize, uint8_t* buffer, uint16_t bufSize, uint16_t timeout);
+
+	/** Adds a sample to the batch, sends the batch if it is full
+	 * @param sample The sample data, of sampleSize bytes
+	 */
+	void add(const void* sample);
+
+	/** Adds a variable-length record to the batch, i.e. a Delta::Encoder record
+	 * The batch is sent first if the record does not fit, and afterwards if
+	 * there is no room for another record of sampleSize bytes: for
+	 * variable-length records, sampleSize is the maximum record size.
+	 * @param data The record data
+	 * @param len The length of the record, at most sampleSize bytes
+	 */
+	void append(const uint8_t* data, uint8_t len);
+
+	/** Sends the batch if the deadline of the oldest sample has passed
+	 * Should be called regularly from the main loop.
+	 */
+	void service();
+
+	/** Sends the batch, if it is not empty
+	 * @return false if the batch was dropped because the transmit buffer was full, true otherwise
+	 */
+	bool flush();
+
+	/** Returns the number of samples in the batch */
+	uint8_t count() const{ return m_buffer[4]; }
+
+	/** Returns the number of samples which were dropped because the transmit buffer was full */
+	uint16_t dropped() const{ return m_dropped; }
+
+private:
+	UART& m_uart;
+	const uint8_t* m_sig;
+	uint8_t* m_buffer;
+	uint16_t m_length;
+	uint16_t m_bufSize;
+	uint16_t m_timeout;
+	uint16_t m_dropped;
+	uint8_t m_sampleSize;
+};
+
+/** A MessageBatch of samples of type T with storage for N samples
+ * Example:
+ * @code{.cpp}
+ *   struct Sample { int16_t x, y, z; };
+ *   TypedMessageBatch<Sample, 16> batch(UART1, sig, 0x01, 0x02, 100);
+ *   while(true){
+ *     Sample s = {...};
+ *     batch.add(s);
+ *     batch.service();
+ *   }
+ * @endcode
+ */
+template<typename T, uint8_t N>
+class TypedMessageBatch : public MessageBatch {
+public:
+	/** @see MessageBatch::MessageBatch */
+	TypedMessageBatch(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId, uint16_t timeout)
+		: MessageBatch(uart, sig, msgClass, msgId, sizeof(T), m_storage, sizeof(m_storage), timeout) {}
+
+	/** @see MessageBatch::add */
+	void add(const T& sample){ MessageBatch::add(&sample); }
+
+private:
+	uint8_t m_storage[HEADER_SIZE + N*sizeof(T)];
+};
+
+#endif
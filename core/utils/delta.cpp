@@ -0,0 +1,95 @@
+/** @file delta.cpp
+ *  @brief Delta and varint compression of multi-channel sample streams
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "delta.hpp"
+
+#define DELTA_KEYFRAME 0x80
+#define DELTA_SEQ_MASK 0x7F
+
+static inline uint8_t _writeVarint(int16_t value, uint8_t* out)
+{
+	// Zigzag: map signed to unsigned so that small magnitudes give small codes
+	uint16_t zz = (uint16_t(value) << 1) ^ uint16_t(value >> 15);
+	uint8_t n = 0;
+	while(zz >= 0x80){
+		out[n++] = zz | 0x80;
+		zz >>= 7;
+	}
+	out[n++] = zz;
+	return n;
+}
+
+static inline uint8_t _readVarint(const uint8_t* in, uint16_t len, int16_t& value)
+{
+	uint16_t zz = 0;
+	for(uint8_t n = 0, shift = 0; n < len && n < 3; ++n, shift += 7){
+		zz |= uint16_t(in[n] & 0x7F) << shift;
+		if((in[n] & 0x80) == 0){
+			value = int16_t(zz >> 1) ^ -int16_t(zz & 0x01);
+			return n + 1;
+		}
+	}
+	return 0;
+}
+
+Delta::Encoder::Encoder(uint8_t channels, int16_t* state, uint8_t keyframeInterval)
+	: m_state(state), m_channels(channels), m_keyframeInterval(keyframeInterval), m_count(0), m_seq(0)
+{
+}
+
+uint8_t Delta::Encoder::encode(const int16_t* samples, uint8_t* out)
+{
+	bool keyframe = m_count == 0;
+	if(++m_count >= m_keyframeInterval){
+		m_count = 0;
+	}
+	out[0] = (keyframe ? DELTA_KEYFRAME : 0) | m_seq;
+	m_seq = (m_seq + 1) & DELTA_SEQ_MASK;
+	uint8_t len = 1;
+	for(uint8_t i = 0; i < m_channels; ++i){
+		// Differences wrap around modulo 2^16, the decoder wraps them back
+		int16_t value = keyframe ? samples[i] : int16_t(samples[i] - m_state[i]);
+		len += _writeVarint(value, out + len);
+		m_state[i] = samples[i];
+	}
+	return len;
+}
+
+Delta::Decoder::Decoder(uint8_t channels, int16_t* state)
+	: m_state(state), m_channels(channels), m_seq(0), m_synced(false)
+{
+}
+
+uint8_t Delta::Decoder::decode(const uint8_t* in, uint16_t len, int16_t* samples)
+{
+	if(len == 0){
+		return 0;
+	}
+	bool keyframe = (in[0] & DELTA_KEYFRAME) != 0;
+	uint8_t seq = in[0] & DELTA_SEQ_MASK;
+	// A gap in the sequence means a lost record: wait for the next keyframe
+	m_synced = keyframe || (m_synced && seq == m_seq);
+	m_seq = (seq + 1) & DELTA_SEQ_MASK;
+	uint8_t pos = 1;
+	for(uint8_t i = 0; i < m_channels; ++i){
+		int16_t value;
+		uint8_t n = _readVarint(in + pos, len - pos, value);
+		if(n == 0){
+			m_synced = false;
+			return 0;
+		}
+		pos += n;
+		samples[i] = keyframe ? value : int16_t(m_state[i] + value);
+	}
+	if(!m_synced){
+		return pos;
+	}
+	for(uint8_t i = 0; i < m_channels; ++i){
+		m_state[i] = samples[i];
+	}
+	return pos;
+}
@@ -0,0 +1,99 @@
+/** @file delta.hpp
+ *  @brief Delta and varint compression of multi-channel sample streams
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef DELTA_HPP
+#define DELTA_HPP
+
+#include <common.hpp>
+
+/** Encoded record format:
+ * [HEADER:1 VALUE_0:1-3 ... VALUE_{CHANNELS-1}:1-3]
+ * - HEADER: bit 7 is set for keyframes, bits 0-6 are a sequence counter
+ * - VALUE: zigzag-encoded varint (7 bits per byte, LSB first, bit 7 = more bytes follow)
+ *          of the absolute sample value (keyframes) or of the difference to
+ *          the previous sample of the same channel (other records)
+ * Records can be concatenated in a message payload. A host-side decoder is
+ * available in tools/telemetry.py, which decodes the payloads of batch
+ * messages (@see batch.hpp) with -c CHANNELS:
+ * @code{.cpp}
+ *   int16_t state[3];
+ *   Delta::Encoder encoder(3, state, 32);
+ *   uint8_t storage[MessageBatch::HEADER_SIZE + 64];
+ *   MessageBatch batch(UART1, sig, 0x01, 0x03, Delta::maxRecordSize(3), storage, sizeof(storage), 100);
+ *   while(true){
+ *     int16_t sample[3] = {...};
+ *     uint8_t record[10]; // Delta::maxRecordSize(3)
+ *     batch.append(record, encoder.encode(sample, record));
+ *     batch.service();
+ *   }
+ * @endcode
+ * A batch which is dropped because the transmit buffer is full shows up as
+ * a sequence gap, the decoder resynchronizes at the next keyframe.
+ */
+namespace Delta {
+	/** Maximum encoded size of a record with the specified number of channels */
+	inline uint16_t maxRecordSize(uint8_t channels){ return 1 + 3*channels; }
+
+	/** Encodes a stream of multi-channel samples */
+	class Encoder {
+	public:
+		/**
+		 * @param channels The number of channels per sample
+		 * @param state    Storage for the previous sample, must hold channels values
+		 * @param keyframeInterval Every keyframeInterval-th record is a keyframe
+		 */
+		Encoder(uint8_t channels, int16_t* state, uint8_t keyframeInterval);
+
+		/** Encodes a sample
+		 * @param samples The sample values, one per channel
+		 * @param out The output buffer, must hold at least maxRecordSize(channels) bytes
+		 * @return The number of bytes written to out
+		 */
+		uint8_t encode(const int16_t* samples, uint8_t* out);
+
+		/** Forces the next record to be a keyframe */
+		void reset(){ m_count = 0; }
+
+	private:
+		int16_t* m_state;
+		uint8_t m_channels;
+		uint8_t m_keyframeInterval;
+		uint8_t m_count;
+		uint8_t m_seq;
+	};
+
+	/** Decodes a stream of records produced by Encoder */
+	class Decoder {
+	public:
+		/**
+		 * @param channels The number of channels per sample
+		 * @param state    Storage for the previous sample, must hold channels values
+		 */
+		Decoder(uint8_t channels, int16_t* state);
+
+		/** Decodes a record
+		 * Records following a lost record cannot be decoded until the next
+		 * keyframe, @see synced.
+		 * @param in The input data
+		 * @param len The length of the input data
+		 * @param samples The decoded sample values, one per channel
+		 * @return The number of bytes consumed, 0 on a malformed record
+		 */
+		uint8_t decode(const uint8_t* in, uint16_t len, int16_t* samples);
+
+		/** Returns whether the samples of the last decoded record are valid */
+		bool synced() const{ return m_synced; }
+
+	private:
+		int16_t* m_state;
+		uint8_t m_channels;
+		uint8_t m_seq;
+		bool m_synced;
+	};
+}
+
+#endif
@@ -0,0 +1,152 @@
+/** @file filter.cpp
+ *  @brief Fixed-point digital filters for sample streams
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "filter.hpp"
+
+// Compare-exchange of a sorting network: afterwards a <= b
+#define FILTER_SORT(a, b) { if((a) > (b)){ int16_t t = (a); (a) = (b); (b) = t; } }
+
+Filter::MovingAverage::MovingAverage(int16_t* history, uint8_t n)
+	: m_history(history), m_round(n > 0 ? 1 << (n - 1) : 0), m_mask((1 << n) - 1), m_shift(n)
+{
+	reset();
+}
+
+void Filter::MovingAverage::process(int16_t* data, uint8_t count)
+{
+	for(uint8_t i = 0; i < count; ++i){
+		data[i] = process(data[i]);
+	}
+}
+
+void Filter::MovingAverage::reset(int16_t value)
+{
+	for(uint16_t i = 0; i <= m_mask; ++i){
+		m_history[i] = value;
+	}
+	m_sum = int32_t(value) << m_shift;
+	m_index = 0;
+}
+
+void Filter::IIR1::process(int16_t* data, uint8_t count)
+{
+	for(uint8_t i = 0; i < count; ++i){
+		data[i] = process(data[i]);
+	}
+}
+
+Filter::Biquad::Biquad(const Coefficients& coeffs)
+	: m_coeffs(coeffs)
+{
+	reset();
+}
+
+int16_t Filter::Biquad::process(int16_t x)
+{
+	const Coefficients& c = m_coeffs;
+	int32_t acc = m_err;
+	acc += int32_t(c.b0) * x;
+	acc += int32_t(c.b1) * m_x1;
+	acc += int32_t(c.b2) * m_x2;
+	acc -= int32_t(c.a1) * m_y1;
+	acc -= int32_t(c.a2) * m_y2;
+	// Keep the truncated fraction for the next sample (first order noise shaping)
+	m_err = acc & 0x3FFF;
+	acc >>= 14;
+	if(acc > 32767){
+		acc = 32767;
+	}else if(acc < -32768){
+		acc = -32768;
+	}
+	m_x2 = m_x1;
+	m_x1 = x;
+	m_y2 = m_y1;
+	m_y1 = acc;
+	return acc;
+}
+
+void Filter::Biquad::process(int16_t* data, uint8_t count)
+{
+	for(uint8_t i = 0; i < count; ++i){
+		data[i] = process(data[i]);
+	}
+}
+
+void Filter::Biquad::reset(int16_t value)
+{
+	// Steady state for a constant input: y = x * (b0 + b1 + b2) / (1 + a1 + a2)
+	const Coefficients& c = m_coeffs;
+	int32_t num = int32_t(c.b0) + c.b1 + c.b2;
+	int32_t den = 16384L + c.a1 + c.a2;
+	m_x1 = m_x2 = value;
+	m_y1 = m_y2 = den != 0 ? (num * value) / den : 0;
+	m_err = 0;
+}
+
+int16_t Filter::median3(int16_t* p)
+{
+	FILTER_SORT(p[0], p[1]); FILTER_SORT(p[1], p[2]); FILTER_SORT(p[0], p[1]);
+	return p[1];
+}
+
+int16_t Filter::median5(int16_t* p)
+{
+	FILTER_SORT(p[0], p[1]); FILTER_SORT(p[3], p[4]); FILTER_SORT(p[0], p[3]);
+	FILTER_SORT(p[1], p[4]); FILTER_SORT(p[1], p[2]); FILTER_SORT(p[2], p[3]);
+	FILTER_SORT(p[1], p[2]);
+	return p[2];
+}
+
+int16_t Filter::median7(int16_t* p)
+{
+	FILTER_SORT(p[0], p[5]); FILTER_SORT(p[0], p[3]); FILTER_SORT(p[1], p[6]);
+	FILTER_SORT(p[2], p[4]); FILTER_SORT(p[0], p[1]); FILTER_SORT(p[3], p[5]);
+	FILTER_SORT(p[2], p[6]); FILTER_SORT(p[2], p[3]); FILTER_SORT(p[3], p[6]);
+	FILTER_SORT(p[4], p[5]); FILTER_SORT(p[1], p[4]); FILTER_SORT(p[1], p[3]);
+	FILTER_SORT(p[3], p[4]);
+	return p[3];
+}
+
+Filter::Median::Median(uint8_t n)
+	: m_n(n <= 3 ? 3 : n <= 5 ? 5 : 7)
+{
+	reset();
+}
+
+int16_t Filter::Median::process(int16_t x)
+{
+	m_history[m_index] = x;
+	if(++m_index == m_n){
+		m_index = 0;
+	}
+	// The sorting network permutes its input: work on a copy of the window
+	int16_t window[7];
+	for(uint8_t i = 0; i < m_n; ++i){
+		window[i] = m_history[i];
+	}
+	if(m_n == 3){
+		return median3(window);
+	}else if(m_n == 5){
+		return median5(window);
+	}
+	return median7(window);
+}
+
+void Filter::Median::process(int16_t* data, uint8_t count)
+{
+	for(uint8_t i = 0; i < count; ++i){
+		data[i] = process(data[i]);
+	}
+}
+
+void Filter::Median::reset(int16_t value)
+{
+	for(uint8_t i = 0; i < 7; ++i){
+		m_history[i] = value;
+	}
+	m_index = 0;
+}
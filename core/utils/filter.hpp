@@ -0,0 +1,183 @@
+/** @file filter.hpp
+ *  @brief Fixed-point digital filters for sample streams
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <common.hpp>
+#include <stdio.h>
+
+/** Fixed-point filters for 16-bit samples
+ * The filters use integer arithmetic only, with 16x16->32 bit multiplications
+ * for the coefficients. Inputs should not exceed 14 bits (i.e. A2D results,
+ * including oversampled results) to leave headroom in the accumulators.
+ * Every filter can process single samples or blocks of samples in place, i.e.
+ * blocks read from a CRingBuffer:
+ * @code{.cpp}
+ *   static int16_t history[8];
+ *   Filter::MovingAverage avg(history, 3); // 8 samples
+ *   int16_t block[16];
+ *   uint8_t n = buffer.read((uint16_t*)block, 16);
+ *   avg.process(block, n);
+ * @endcode
+ */
+namespace Filter {
+	/** Converts a real number to a Q15 coefficient (compile-time use only) */
+	#define FILTER_Q15(x) ((int16_t)((x) * 32768.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+	/** Converts a real number to a Q2.14 coefficient (compile-time use only) */
+	#define FILTER_Q14(x) ((int16_t)((x) * 16384.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+	/** Moving average over 2^n samples, using a running sum */
+	class MovingAverage {
+	public:
+		/**
+		 * @param history Storage for the last 2^n samples
+		 * @param n The window length exponent, the window has 2^n samples (n <= 8)
+		 */
+		MovingAverage(int16_t* history, uint8_t n);
+
+		/** Filters a sample
+		 * @param x The input sample
+		 * @return The average of the last 2^n samples
+		 */
+		int16_t process(int16_t x){
+			m_sum += x - m_history[m_index];
+			m_history[m_index] = x;
+			m_index = (m_index + 1) & m_mask;
+			return (m_sum + m_round) >> m_shift;
+		}
+
+		/** Filters a block of samples in place */
+		void process(int16_t* data, uint8_t count);
+
+		/** Resets the filter state to the specified value */
+		void reset(int16_t value = 0);
+
+	private:
+		int16_t* m_history;
+		int32_t m_sum;
+		int16_t m_round;
+		uint8_t m_index, m_mask, m_shift;
+	};
+
+	/** Single-pole low-pass IIR filter: y += alpha*(x - y)
+	 * The state is kept with 8 fractional bits, such that small values of
+	 * alpha do not stall the output.
+	 */
+	class IIR1 {
+	public:
+		/**
+		 * @param alpha The smoothing factor in Q15, @see FILTER_Q15
+		 *              alpha = 1 - exp(-2*pi*fc/fs) for a cut-off frequency fc at sample rate fs
+		 */
+		IIR1(int16_t alpha) : m_state(0), m_alpha(alpha) {}
+
+		/** Filters a sample
+		 * @param x The input sample
+		 * @return The filtered sample
+		 */
+		int16_t process(int16_t x){
+			int16_t err = x - int16_t((m_state + 0x80) >> 8);
+			m_state += (int32_t(err) * m_alpha) >> 7;
+			return (m_state + 0x80) >> 8;
+		}
+
+		/** Filters a block of samples in place */
+		void process(int16_t* data, uint8_t count);
+
+		/** Resets the filter state to the specified value */
+		void reset(int16_t value = 0){ m_state = int32_t(value) << 8; }
+
+	private:
+		int32_t m_state;
+		int16_t m_alpha;
+	};
+
+	/** Biquad (second order IIR) filter, direct form I
+	 * y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+	 * The coefficients are Q2.14, @see FILTER_Q14, which covers the range
+	 * [-2, 2) needed by the feedback coefficients of typical low-pass, high-pass
+	 * and notch designs (normalized such that a0 = 1).
+	 */
+	class Biquad {
+	public:
+		/** Filter coefficients in Q2.14 */
+		struct Coefficients {
+			int16_t b0, b1, b2, a1, a2;
+		};
+
+		/**
+		 * @param coeffs The coefficients, must remain valid while the filter is used
+		 */
+		Biquad(const Coefficients& coeffs);
+
+		/** Filters a sample
+		 * @param x The input sample
+		 * @return The filtered sample, saturated to 16 bits
+		 */
+		int16_t process(int16_t x);
+
+		/** Filters a block of samples in place */
+		void process(int16_t* data, uint8_t count);
+
+		/** Resets the filter state to the specified steady-state input value */
+		void reset(int16_t value = 0);
+
+	private:
+		const Coefficients& m_coeffs;
+		int16_t m_x1, m_x2, m_y1, m_y2;
+		int16_t m_err; //!< Truncation error feedback, fractional bits of the last output
+	};
+
+	/** Median of 3, 5 or 7 samples, using a sorting network
+	 * @param data The samples (the array is partially sorted in place)
+	 * @return The median
+	 */
+	int16_t median3(int16_t* data);
+	int16_t median5(int16_t* data);
+	int16_t median7(int16_t* data);
+
+	/** Sliding median filter over 3, 5 or 7 samples */
+	class Median {
+	public:
+		/**
+		 * @param n The window length, either 3, 5 or 7 (other values are
+		 *          rounded up to the next of these, at most 7)
+		 */
+		Median(uint8_t n);
+
+		/** Filters a sample
+		 * @param x The input sample
+		 * @return The median of the last n samples
+		 */
+		int16_t process(int16_t x);
+
+		/** Filters a block of samples in place */
+		void process(int16_t* data, uint8_t count);
+
+		/** Resets the filter state to the specified value */
+		void reset(int16_t value = 0);
+
+	private:
+		int16_t m_history[7];
+		uint8_t m_n, m_index;
+	};
+
+	/** Measures the number of CPU cycles per sample of each filter type and
+	 *  prints a table to the specified stream
+	 *  Timer 1 is temporarily clocked at F_CPU and interrupts are disabled
+	 *  during each measurement, the previous Timer 1 configuration and count
+	 *  are restored afterwards (hence Timer1::elapsed does not advance while
+	 *  the benchmark runs, and armed CSoftTimers are delayed by its duration).
+	 *  Defined in filterbench.cpp, which needs to be added to the sources.
+	 * @param out The output stream
+	 */
+	void benchmark(FILE* out);
+}
+
+#endif
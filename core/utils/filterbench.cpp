@@ -0,0 +1,94 @@
+/** @file filterbench.cpp
+ *  @brief Cycle benchmark of the fixed-point digital filters
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "filter.hpp"
+#include <avr/pgmspace.h>
+
+#define BENCH_SAMPLES 32
+#define BENCH_TIFR1   (_BV(ICF1) | _BV(OCF1C) | _BV(OCF1B) | _BV(OCF1A) | _BV(TOV1))
+
+// Fills the block with a noisy ramp
+static void _benchInput(int16_t* data)
+{
+	uint16_t lfsr = 0xACE1;
+	for(uint8_t i = 0; i < BENCH_SAMPLES; ++i){
+		lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB400);
+		data[i] = i*16 + (lfsr & 0x3F);
+	}
+}
+
+// Starts a measurement: Timer 1 counts CPU cycles, interrupts are disabled
+#define BENCH_START \
+	_benchInput(data); \
+	cli(); \
+	TCNT1 = 0;
+
+// Stops a measurement and prints the cycles per sample
+#define BENCH_STOP(name) \
+	cycles = TCNT1; \
+	sei(); \
+	fprintf_P(out, PSTR("%-16S %6u\n"), PSTR(name), (cycles - overhead)/BENCH_SAMPLES);
+
+void Filter::benchmark(FILE* out)
+{
+	static int16_t history[16];
+	static const Biquad::Coefficients lowpass = {
+		// Butterworth low-pass, fc = fs/10
+		FILTER_Q14(0.0674553), FILTER_Q14(0.1349106), FILTER_Q14(0.0674553),
+		FILTER_Q14(-1.1429805), FILTER_Q14(0.4128016)
+	};
+	int16_t data[BENCH_SAMPLES];
+	uint16_t cycles, overhead;
+
+	// Save Timer 1 state and clock it at F_CPU
+	uint8_t _sreg = SREG;
+	cli();
+	uint8_t tccr1a = TCCR1A, tccr1b = TCCR1B, timsk1 = TIMSK1;
+	uint8_t tifr1 = TIFR1;
+	uint16_t tcnt1 = TCNT1, ocr1a = OCR1A;
+	TIMSK1 = 0x00;
+	TCCR1A = 0x00;
+	TCCR1B = 0x01;
+
+	fprintf_P(out, PSTR("filter     cycles/sample\n"));
+
+	// Overhead of reading the counter
+	cli();
+	TCNT1 = 0;
+	overhead = TCNT1;
+
+	MovingAverage avg(history, 4);
+	BENCH_START avg.process(data, BENCH_SAMPLES); BENCH_STOP("moving avg 16")
+
+	IIR1 iir(FILTER_Q15(0.1));
+	BENCH_START iir.process(data, BENCH_SAMPLES); BENCH_STOP("iir1")
+
+	Biquad biquad(lowpass);
+	BENCH_START biquad.process(data, BENCH_SAMPLES); BENCH_STOP("biquad")
+
+	Median med3(3);
+	BENCH_START med3.process(data, BENCH_SAMPLES); BENCH_STOP("median 3")
+
+	Median med5(5);
+	BENCH_START med5.process(data, BENCH_SAMPLES); BENCH_STOP("median 5")
+
+	Median med7(7);
+	BENCH_START med7.process(data, BENCH_SAMPLES); BENCH_STOP("median 7")
+
+	// Restore Timer 1 state
+	cli();
+	TCCR1B = tccr1b;
+	TCCR1A = tccr1a;
+	TCNT1 = tcnt1;
+	OCR1A = ocr1a;
+	// Clear the flags raised while counting cycles, which would otherwise
+	// trigger a spurious overflow and compare match. Flags pending on entry
+	// cannot be set again, hence are left alone.
+	TIFR1 = BENCH_TIFR1 & ~tifr1;
+	TIMSK1 = timsk1;
+	SREG = _sreg;
+}
@@ -0,0 +1,98 @@
+/** @file log.cpp
+ *  @brief Deferred binary logging, formatted on the host
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "log.hpp"
+#include "message.hpp"
+#include <axon/ringbuffer.hpp>
+#include <axon/timer.hpp>
+#include <string.h>
+
+#define LOG_MESSAGE_SIZE 96 // Maximum payload of a message
+
+static uint8_t log_data[LOG_BUFFER_SIZE];
+static CRingBuffer<uint8_t> log_buffer(log_data, LOG_BUFFER_SIZE);
+static volatile uint16_t log_dropped; // Records which did not fit in the buffer
+static uint16_t log_reported;         // Drops already reported
+
+void Log::Record::append(const void* data, uint8_t size)
+{
+	if(size > LOG_MAX_ARGS - m_length){
+		size = LOG_MAX_ARGS - m_length;
+	}
+	memcpy(m_args + m_length, data, size);
+	m_length += size;
+}
+
+Log::Record& Log::Record::operator,(const char* s)
+{
+	uint8_t len = strnlen(s, LOG_MAX_ARGS - 1);
+	append(s, len);
+	// Always terminate, even if truncated
+	uint8_t nul = 0;
+	if(m_length == LOG_MAX_ARGS){
+		m_args[LOG_MAX_ARGS - 1] = 0;
+	}else{
+		append(&nul, 1);
+	}
+	return *this;
+}
+
+void Log::Record::commit()
+{
+	disable_interrupts;
+	// Records are queued as a whole or not at all
+	if(LOG_BUFFER_SIZE - 1 - log_buffer.size() < 3 + m_length){
+		log_dropped = log_dropped + 1;
+	}else{
+		log_buffer.push(uint8_t(m_site));
+		log_buffer.push(uint8_t(m_site >> 8));
+		log_buffer.push(m_length);
+		for(uint8_t i = 0; i < m_length; ++i){
+			log_buffer.push(m_args[i]);
+		}
+	}
+	restore_interrupts;
+}
+
+void Log::service(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId)
+{
+	// Header: [CLASS:1 ID:1 LENGTH:2 TIME:4 LOST:2]
+	uint8_t msg[4 + 6 + LOG_MESSAGE_SIZE];
+	uint16_t dropped = lost();
+	if(log_buffer.empty() && dropped == log_reported){
+		return;
+	}
+	// Records cannot be peeked, hence reserve room for a full message
+	if(!Message::canSend(uart, sizeof(msg))){
+		return;
+	}
+	// Only whole records are sent: stop when the largest possible one might not fit
+	uint16_t length = 4 + 6;
+	uint8_t available = log_buffer.size();
+	while(available > 0 && length + 3 + LOG_MAX_ARGS <= uint16_t(sizeof(msg))){
+		uint8_t* record = msg + length;
+		log_buffer.read(record, 3);
+		log_buffer.read(record + 3, record[2]);
+		length += 3 + record[2];
+		available -= 3 + record[2];
+	}
+	msg[0] = msgClass;
+	msg[1] = msgId;
+	*(uint16_t*)(msg + 2) = length - 4;
+	*(uint32_t*)(msg + 4) = Timer1::elapsed();
+	*(uint16_t*)(msg + 8) = dropped - log_reported;
+	log_reported = dropped;
+	Message::send(uart, sig, msg, length);
+}
+
+uint16_t Log::lost()
+{
+	disable_interrupts;
+	uint16_t dropped = log_dropped;
+	restore_interrupts;
+	return dropped;
+}
@@ -0,0 +1,126 @@
+/** @file log.hpp
+ *  @brief Deferred binary logging, formatted on the host
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <common.hpp>
+
+class UART;
+
+/** Size of the log buffer in bytes (power of two, at most 256) */
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 256
+#endif
+
+/** Maximum number of argument bytes of a log record */
+#ifndef LOG_MAX_ARGS
+#define LOG_MAX_ARGS 24
+#endif
+
+/** Deferred logging
+ *  LOG(fmt, ...) does not format anything on the device: the format string
+ *  is stored in the .logstrings section of the ELF file, which is not
+ *  allocated, hence neither occupies flash nor SRAM. At runtime, only the
+ *  offset of the format string (the site id) and the raw argument bytes
+ *  are queued, and sent over a UART by service(). tools/logdecode.py reads
+ *  the format strings from the ELF file ($(BUILDDIR)/$(NAME).bin) and
+ *  prints the formatted lines.
+ *
+ *  Arguments are stored with their printf promotion size: 2 bytes for char,
+ *  short and int (%d %u %x %c ...), 4 bytes for long (%ld %lu %lx ...) and
+ *  float/double (%f %e %g), strings (%s) are copied NUL-terminated. The
+ *  arguments must match the conversions of the format string. Format
+ *  strings must be single string literals (no concatenation). Records which
+ *  do not fit in the buffer are dropped and counted.
+ *
+ *  LOG can be used from interrupts and from the main context.
+ *
+ *  Message payload: [TIME:4 LOST:2 RECORDS]
+ *  where TIME is Timer1::elapsed() at the time of sending, LOST the number
+ *  of records dropped since the previous message, and each record is
+ *  [SITE:2 LENGTH:1 ARGS:LENGTH].
+ *
+ *  Example:
+ *  @code
+ *  LOG("battery %u mV, temperature %f C", millivolts, temperature);
+ *  ...
+ *  Log::service(uart, sig, 0xF0, 0x03);
+ *  @endcode
+ */
+namespace Log {
+	/** A log record being assembled, @see LOG */
+	class Record {
+	public:
+		Record(uint16_t site) : m_site(site), m_length(0) {}
+
+		/** Append raw argument bytes (truncated to LOG_MAX_ARGS) */
+		void append(const void* data, uint8_t size);
+
+		/** Queue the record */
+		void commit();
+
+		Record& operator,(char v){ return add16(v); }
+		Record& operator,(signed char v){ return add16(v); }
+		Record& operator,(unsigned char v){ return add16(v); }
+		Record& operator,(short v){ return add16(v); }
+		Record& operator,(unsigned short v){ return add16(v); }
+		Record& operator,(int v){ return add16(v); }
+		Record& operator,(unsigned int v){ return add16(v); }
+		Record& operator,(long v){ return add32(v); }
+		Record& operator,(unsigned long v){ return add32(v); }
+		Record& operator,(float v){ append(&v, 4); return *this; }
+		Record& operator,(double v){ float f = v; append(&f, 4); return *this; }
+		Record& operator,(const char* s);
+		Record& operator,(const void* p){ return add16(uint16_t(uintptr_t(p))); }
+
+	private:
+		uint16_t m_site;
+		uint8_t m_length;
+		uint8_t m_args[LOG_MAX_ARGS];
+
+		Record& add16(uint16_t v){ append(&v, 2); return *this; }
+		Record& add32(uint32_t v){ append(&v, 4); return *this; }
+	};
+
+	/** Send queued records if the transmit buffer has room
+	 *  Call periodically, each call sends at most one message.
+	 * @param uart The uart port
+	 * @param sig The message start signature
+	 * @param msgClass The message class
+	 * @param msgId The message id
+	 */
+	void service(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId);
+
+	/** Return the number of records dropped since start-up */
+	uint16_t lost();
+}
+
+/** Evaluates to the site id of a format string, i.e. its offset in the
+ *  .logstrings section. The string is emitted by a basic asm statement
+ *  (extended asm would interpret the % conversions), the numeric label is
+ *  then loaded by the following extended asm statement. */
+#define LOG_SITE(fmt) ({ \
+	uint16_t _logSite; \
+	__asm__ __volatile__( \
+		".pushsection .logstrings,\"\",@progbits\n" \
+		"1: .asciz " #fmt "\n" \
+		".popsection"); \
+	__asm__ __volatile__( \
+		"ldi %A0, lo8(1b)\n\t" \
+		"ldi %B0, hi8(1b)" : "=d" (_logSite)); \
+	_logSite; })
+
+/** Log a message, formatted on the host with printf semantics */
+#define LOG(fmt, ...) \
+	do{ \
+		Log::Record _logRecord(LOG_SITE(fmt)); \
+		(void)(_logRecord , ##__VA_ARGS__); \
+		_logRecord.commit(); \
+	}while(0)
+
+#endif // LOG_HPP
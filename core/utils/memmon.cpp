@@ -0,0 +1,146 @@
+/** @file memmon.cpp
+ *  @brief SRAM and stack high-watermark monitor
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "memmon.hpp"
+#include <avr/pgmspace.h>
+
+extern char __heap_start;
+extern char* __brkval;
+
+static uint8_t* memmon_heapHigh;              // Highest heap top since the last repaint
+static volatile uint16_t memmon_minGap = 0xFFFF;
+static uint16_t memmon_threshold;
+static MemMon::Alarm memmon_alarm;
+
+// Runs before .init4 (copy of .data, clearing of .bss), with SP at RAMEND
+// and no call frame, hence in assembler.
+void memmon_paint() __attribute__((naked, used, section(".init3")));
+void memmon_paint()
+{
+	__asm__ __volatile__(
+		"ldi r30, lo8(__heap_start)\n\t"
+		"ldi r31, hi8(__heap_start)\n\t"
+		"ldi r24, %0\n\t"
+		"ldi r25, hi8(%1)\n"
+		"1:\n\t"
+		"st Z+, r24\n\t"
+		"cpi r30, lo8(%1)\n\t"
+		"cpc r31, r25\n\t"
+		"brne 1b"
+		:: "M" (MEMMON_CANARY), "i" (RAMEND + 1)
+		: "r24", "r25", "r30", "r31");
+}
+
+static uint8_t* memmon_heapTop()
+{
+	disable_interrupts;
+	char* top = __brkval;
+	restore_interrupts;
+	return (uint8_t*)(top ? top : &__heap_start);
+}
+
+// The bytes between the heap top and the highest heap top may still hold
+// released heap data instead of the canary, hence scan from the latter.
+static uint8_t* memmon_stackLow(uint8_t* heapTop)
+{
+	disable_interrupts;
+	if(heapTop > memmon_heapHigh){
+		memmon_heapHigh = heapTop;
+	}
+	const uint8_t* p = memmon_heapHigh;
+	restore_interrupts;
+	while(p <= (const uint8_t*)RAMEND && *p == MEMMON_CANARY){
+		++p;
+	}
+	return (uint8_t*)p;
+}
+
+static uint16_t memmon_update(uint16_t gap)
+{
+	disable_interrupts;
+	if(gap < memmon_minGap){
+		memmon_minGap = gap;
+	}
+	restore_interrupts;
+	return gap;
+}
+
+void MemMon::report(Report& report)
+{
+	uint8_t* top = memmon_heapTop();
+	// Repaint the memory released at the top of the heap. Interrupts are
+	// disabled, hence nothing below the stack pointer is in use.
+	disable_interrupts;
+	uint8_t* end = (uint8_t*)uintptr_t(SP);
+	if(memmon_heapHigh < end){
+		end = memmon_heapHigh;
+	}
+	for(uint8_t* p = top; p < end; ++p){
+		*p = MEMMON_CANARY;
+	}
+	memmon_heapHigh = top;
+	restore_interrupts;
+	uint8_t* low = memmon_stackLow(top);
+	report.heapTop = uint16_t(uintptr_t(top));
+	report.stackLow = uint16_t(uintptr_t(low));
+	report.stackUsed = RAMEND + 1 - uint16_t(uintptr_t(low));
+	report.freeGap = memmon_update(low - top);
+	report.minGap = minGap();
+}
+
+uint16_t MemMon::stackLow()
+{
+	return uint16_t(uintptr_t(memmon_stackLow(memmon_heapTop())));
+}
+
+uint16_t MemMon::heapTop()
+{
+	return uint16_t(uintptr_t(memmon_heapTop()));
+}
+
+uint16_t MemMon::freeGap()
+{
+	uint8_t* top = memmon_heapTop();
+	return memmon_update(memmon_stackLow(top) - top);
+}
+
+uint16_t MemMon::minGap()
+{
+	disable_interrupts;
+	uint16_t gap = memmon_minGap;
+	restore_interrupts;
+	return gap;
+}
+
+void MemMon::setAlarm(uint16_t threshold, Alarm alarm)
+{
+	disable_interrupts;
+	memmon_threshold = threshold;
+	memmon_alarm = alarm;
+	restore_interrupts;
+}
+
+void MemMon::check()
+{
+	uint16_t gap = freeGap();
+	if(memmon_alarm != 0 && gap < memmon_threshold){
+		memmon_alarm(gap);
+	}
+}
+
+void MemMon::timerCallback(void* /*arg*/)
+{
+	check();
+}
+
+void MemMon::dump(FILE* out)
+{
+	Report r;
+	report(r);
+	fprintf_P(out, PSTR("heap top 0x%04x, stack low 0x%04x (%u bytes used), gap %u bytes (min %u)\n"),
+	          r.heapTop, r.stackLow, r.stackUsed, r.freeGap, r.minGap);
+}
@@ -0,0 +1,103 @@
+/** @file memmon.hpp
+ *  @brief SRAM and stack high-watermark monitor
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef MEMMON_HPP
+#define MEMMON_HPP
+
+#include <common.hpp>
+#include <stdio.h>
+
+/** Value painted into free SRAM */
+#define MEMMON_CANARY 0xC5
+
+/** SRAM monitor
+ *  Linking utils/memmon.cpp paints the SRAM between the end of the static
+ *  data (__heap_start) and RAMEND with MEMMON_CANARY in .init3, before the
+ *  static data is initialized and before main() is called. The heap grows
+ *  upwards from __heap_start, the stack downwards from RAMEND: the bytes
+ *  still holding the canary above the heap top have never been touched by
+ *  the stack.
+ *
+ *  The stack watermark is the lowest address written by the stack, found by
+ *  scanning upwards from the heap top for the first byte not holding the
+ *  canary. The scan is proportional to the free gap, about four cycles per
+ *  byte. Unused parts at the bottom of the deepest stack frame are not
+ *  detected, hence keep some margin.
+ *
+ *  Memory released at the top of the heap still holds heap data: the scan
+ *  starts at the highest heap top seen, and the released bytes count as
+ *  free. They are repainted by report(), until then stack use reaching into
+ *  them is not detected.
+ *
+ *  check() scans the free gap, about 2 ms for 8 KB at 16 MHz. Called from
+ *  a CSoftTimer callback, it runs in the Timer1 interrupt and delays all
+ *  other interrupts by as much: use a low rate, or post it to a Scheduler
+ *  task instead (@see Scheduler::timerCallback).
+ *
+ *  Example:
+ *  @code
+ *  static void onLowMemory(uint16_t gap){ ... }
+ *  CSoftTimer memTimer(MemMon::timerCallback);
+ *  MemMon::setAlarm(256, onLowMemory);
+ *  memTimer.startPeriodic(100000UL); // blocks interrupts for up to 2 ms every 100 ms
+ *  ...
+ *  MemMon::dump(stdout);
+ *  @endcode
+ */
+namespace MemMon {
+	/** Memory usage */
+	struct Report {
+		uint16_t heapTop;   //!< First address above the heap
+		uint16_t stackLow;  //!< Lowest address ever written by the stack
+		uint16_t stackUsed; //!< Maximum stack usage in bytes
+		uint16_t freeGap;   //!< Untouched bytes between heap and stack
+		uint16_t minGap;    //!< Minimum gap of all checks so far
+	};
+
+	/** Alarm callback, called with the current gap in bytes */
+	typedef void (*Alarm)(uint16_t gap);
+
+	/** Get the current memory usage (main context only)
+	 *  Repaints memory released at the top of the heap, with interrupts
+	 *  disabled.
+	 * @param report The report to fill
+	 */
+	void report(Report& report);
+
+	/** Return the lowest address ever written by the stack */
+	uint16_t stackLow();
+
+	/** Return the first address above the heap */
+	uint16_t heapTop();
+
+	/** Return the number of untouched bytes between heap and stack */
+	uint16_t freeGap();
+
+	/** Return the minimum gap of all checks so far */
+	uint16_t minGap();
+
+	/** Set the alarm
+	 * @param threshold The gap in bytes below which check() calls the alarm
+	 * @param alarm The callback, 0 to disable the alarm
+	 */
+	void setAlarm(uint16_t threshold, Alarm alarm);
+
+	/** Update the minimum gap and call the alarm if it is below the threshold
+	 *  Can be called from interrupts.
+	 */
+	void check();
+
+	/** CSoftTimer (or Scheduler) callback calling check() */
+	void timerCallback(void* arg);
+
+	/** Print the memory usage
+	 * @param out The output stream
+	 */
+	void dump(FILE* out);
+}
+
+#endif // MEMMON_HPP
@@ -0,0 +1,194 @@
+/** @file nmea.cpp
+ *  @brief Streaming parser for NMEA 0183 sentences
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "nmea.hpp"
+#include <axon/uart.hpp>
+
+// Significant fractional digits kept per field
+#define NMEA_MAX_FRAC_DIGITS 5
+
+#define NMEA_TAG(a, b, c) ((uint32_t(a) << 16) | (uint32_t(b) << 8) | uint32_t(c))
+
+enum EState { STATE_IDLE, STATE_DATA, STATE_CHECKSUM1, STATE_CHECKSUM2 };
+
+static inline uint8_t _hexValue(char c)
+{
+	return c <= '9' ? c - '0' : (c & ~0x20) - 'A' + 10;
+}
+
+NMEA::Parser::Parser()
+	: m_state(STATE_IDLE), m_checksumErrors(0)
+{
+	m_fix.time = m_fix.date = 0;
+	m_fix.lat = m_fix.lon = m_fix.altitude = 0;
+	m_fix.speed = 0;
+	m_fix.course = m_fix.hdop = 0;
+	m_fix.quality = m_fix.satellites = 0;
+	m_fix.valid = false;
+	m_pending = m_fix;
+}
+
+NMEA::ESentence NMEA::Parser::parse(char c)
+{
+	if(c == '$'){
+		// Start of sentence: always resynchronize
+		m_state = STATE_DATA;
+		m_field = 0;
+		m_sentence = SENTENCE_NONE;
+		m_checksum = 0;
+		m_tag = 0;
+		m_pending = m_fix;
+		m_int = m_frac = 0;
+		m_fracDigits = 0;
+		m_negative = false;
+		m_empty = true;
+		m_first = 0;
+		return SENTENCE_NONE;
+	}
+	switch(m_state){
+	case STATE_DATA:
+		if(c == '*'){
+			endField();
+			m_state = STATE_CHECKSUM1;
+			break;
+		}
+		m_checksum ^= c;
+		if(c == ','){
+			endField();
+			++m_field;
+			m_int = m_frac = 0;
+			m_fracDigits = 0;
+			m_negative = false;
+			m_empty = true;
+			m_first = 0;
+		}else if(m_field == 0){
+			m_tag = (m_tag << 8) | uint8_t(c);
+		}else{
+			if(m_empty){
+				m_first = c;
+				m_empty = false;
+			}
+			if(c >= '0' && c <= '9'){
+				if(m_fracDigits == 0){
+					m_int = m_int * 10 + (c - '0');
+				}else if(m_fracDigits <= NMEA_MAX_FRAC_DIGITS){
+					m_frac = m_frac * 10 + (c - '0');
+					++m_fracDigits;
+				}
+			}else if(c == '.'){
+				m_fracDigits = 1; // Counts the digits plus one
+			}else if(c == '-'){
+				m_negative = true;
+			}
+		}
+		break;
+	case STATE_CHECKSUM1:
+		m_received = _hexValue(c) << 4;
+		m_state = STATE_CHECKSUM2;
+		break;
+	case STATE_CHECKSUM2:
+		m_received |= _hexValue(c);
+		m_state = STATE_IDLE;
+		if(m_received != m_checksum){
+			++m_checksumErrors;
+		}else if(m_sentence != SENTENCE_NONE){
+			m_fix = m_pending;
+			return ESentence(m_sentence);
+		}
+		break;
+	}
+	return SENTENCE_NONE;
+}
+
+NMEA::ESentence NMEA::Parser::poll(UART& uart)
+{
+	while(!uart.receiveBufferEmpty()){
+		ESentence s = parse(uart.getByte());
+		if(s != SENTENCE_NONE){
+			return s;
+		}
+	}
+	return SENTENCE_NONE;
+}
+
+// Returns the field value scaled by 10^digits
+uint32_t NMEA::Parser::fixed(uint8_t digits) const
+{
+	uint32_t value = m_int;
+	uint32_t frac = m_frac;
+	uint8_t fracDigits = m_fracDigits > 0 ? m_fracDigits - 1 : 0;
+	for(uint8_t i = 0; i < digits; ++i){
+		value *= 10;
+	}
+	for(; fracDigits < digits; ++fracDigits){
+		frac *= 10;
+	}
+	for(; fracDigits > digits; --fracDigits){
+		frac /= 10;
+	}
+	return value + frac;
+}
+
+// Converts a [d]ddmm.mmmm field to 1e-7 degrees
+int32_t NMEA::Parser::coordinate() const
+{
+	uint32_t degrees = m_int / 100;
+	uint32_t minutes = fixed(5) - degrees * 10000000UL; // minutes * 1e5
+	// 1e-7 deg = minutes * 1e7 / 60 = (minutes * 1e5) * 5 / 3
+	return degrees * 10000000L + (minutes * 5) / 3;
+}
+
+// Converts a hhmmss.sss field to milliseconds
+uint32_t NMEA::Parser::timeOfDay() const
+{
+	uint32_t s = (m_int / 10000) * 3600 + ((m_int / 100) % 100) * 60 + m_int % 100;
+	return s * 1000 + (fixed(3) - m_int * 1000);
+}
+
+void NMEA::Parser::endField()
+{
+	if(m_field == 0){
+		uint32_t tag = m_tag & 0x00FFFFFF;
+		if(tag == NMEA_TAG('G', 'G', 'A')){
+			m_sentence = SENTENCE_GGA;
+		}else if(tag == NMEA_TAG('R', 'M', 'C')){
+			m_sentence = SENTENCE_RMC;
+		}
+		return;
+	}
+	if(m_empty){
+		return;
+	}
+	if(m_sentence == SENTENCE_GGA){
+		// $GPGGA,hhmmss.ss,llll.ll,a,yyyyy.yy,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx*hh
+		switch(m_field){
+		case 1: m_pending.time = timeOfDay(); break;
+		case 2: m_pending.lat = coordinate(); break;
+		case 3: if(m_first == 'S'){ m_pending.lat = -m_pending.lat; } break;
+		case 4: m_pending.lon = coordinate(); break;
+		case 5: if(m_first == 'W'){ m_pending.lon = -m_pending.lon; } break;
+		case 6: m_pending.quality = m_int; break;
+		case 7: m_pending.satellites = m_int; break;
+		case 8: m_pending.hdop = fixed(2); break;
+		case 9: m_pending.altitude = m_negative ? -int32_t(fixed(3)) : int32_t(fixed(3)); break;
+		}
+	}else if(m_sentence == SENTENCE_RMC){
+		// $GPRMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,x.x,a*hh
+		switch(m_field){
+		case 1: m_pending.time = timeOfDay(); break;
+		case 2: m_pending.valid = m_first == 'A'; break;
+		case 3: m_pending.lat = coordinate(); break;
+		case 4: if(m_first == 'S'){ m_pending.lat = -m_pending.lat; } break;
+		case 5: m_pending.lon = coordinate(); break;
+		case 6: if(m_first == 'W'){ m_pending.lon = -m_pending.lon; } break;
+		// 1 knot = 0.514444 m/s ~= 1029/2000 m/s
+		case 7: m_pending.speed = (fixed(3) * 1029) / 2000; break;
+		case 8: m_pending.course = fixed(2); break;
+		case 9: m_pending.date = m_int; break;
+		}
+	}
+}
@@ -0,0 +1,99 @@
+/** @file nmea.hpp
+ *  @brief Streaming parser for NMEA 0183 sentences
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef NMEA_HPP
+#define NMEA_HPP
+
+#include <common.hpp>
+
+class UART;
+
+namespace NMEA {
+	/** Supported sentences */
+	enum ESentence {
+		SENTENCE_NONE = 0,
+		SENTENCE_GGA = 1, //!< Fix data
+		SENTENCE_RMC = 2  //!< Recommended minimum data
+	};
+
+	/** Navigation data, all values are fixed-point */
+	struct Fix {
+		uint32_t time;      //!< UTC time of day [ms] (GGA, RMC)
+		uint32_t date;      //!< UTC date as ddmmyy (RMC)
+		int32_t lat;        //!< Latitude [1e-7 deg] (GGA, RMC)
+		int32_t lon;        //!< Longitude [1e-7 deg] (GGA, RMC)
+		int32_t altitude;   //!< Altitude above mean sea level [mm] (GGA)
+		uint32_t speed;     //!< Ground speed [mm/s] (RMC)
+		uint16_t course;    //!< Course over ground [1e-2 deg] (RMC)
+		uint16_t hdop;      //!< Horizontal dilution of precision [1e-2] (GGA)
+		uint8_t quality;    //!< Fix quality, 0: invalid, 1: GPS, 2: DGPS, ... (GGA)
+		uint8_t satellites; //!< Number of satellites in use (GGA)
+		bool valid;         //!< Status, true if the data is valid (RMC)
+	};
+
+	/** Incremental NMEA parser
+	 * Fields are converted to fixed-point values while the characters arrive,
+	 * no line buffer is used. The fields of a sentence are only applied to the
+	 * fix when the checksum of the sentence matches.
+	 * Example:
+	 * @code{.cpp}
+	 *   NMEA::Parser gps;
+	 *   while(true){
+	 *     if(gps.poll(UART2) == NMEA::SENTENCE_RMC){
+	 *       const NMEA::Fix& fix = gps.fix();
+	 *       ...
+	 *     }
+	 *   }
+	 * @endcode
+	 */
+	class Parser {
+	public:
+		Parser();
+
+		/** Processes a character
+		 * @param c The received character
+		 * @return The type of the sentence completed by the character, SENTENCE_NONE otherwise
+		 */
+		ESentence parse(char c);
+
+		/** Processes the characters in the receive buffer of the uart, until a
+		 * supported sentence is completed or the buffer is empty
+		 * @param uart The uart port
+		 * @return The type of the completed sentence, SENTENCE_NONE otherwise
+		 */
+		ESentence poll(UART& uart);
+
+		/** Returns the navigation data */
+		const Fix& fix() const{ return m_fix; }
+
+		/** Returns the number of sentences discarded due to a checksum mismatch */
+		uint16_t checksumErrors() const{ return m_checksumErrors; }
+
+	private:
+		void endField();
+		uint32_t fixed(uint8_t digits) const;
+		int32_t coordinate() const;
+		uint32_t timeOfDay() const;
+
+		Fix m_fix, m_pending;
+		uint32_t m_int;       //!< Integer part of the current field
+		uint32_t m_frac;      //!< Fractional part of the current field
+		uint32_t m_tag;       //!< Last characters of the sentence address field
+		uint8_t m_fracDigits; //!< Number of digits in m_frac
+		uint8_t m_state;
+		uint8_t m_field;
+		uint8_t m_sentence;
+		uint8_t m_checksum;
+		uint8_t m_received;
+		char m_first;         //!< First character of the current field
+		bool m_negative;
+		bool m_empty;
+		uint16_t m_checksumErrors;
+	};
+}
+
+#endif
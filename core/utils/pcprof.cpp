@@ -0,0 +1,160 @@
+/** @file pcprof.cpp
+ *  @brief Statistical program counter sampling profiler
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "pcprof.hpp"
+#include "message.hpp"
+#include <axon/timers.hpp>
+
+#define PCPROF_CHUNK 32 // Buckets per message
+
+#if PCPROF_BUCKETS > 256
+#  error "PCPROF_BUCKETS must be at most 256"
+#endif
+
+static uint16_t pcprof_histogram[PCPROF_BUCKETS];
+static uint16_t pcprof_outside;
+static uint16_t pcprof_start;     // Word address of bucket 0
+static uint8_t pcprof_shift = 8;  // log2 of the bucket size in words
+static uint8_t pcprof_next;       // First bucket of the next message
+static bool pcprof_rangeSet;      // Whether setRange was called
+
+extern "C" void _pcprofRecord(uint16_t pc) __attribute__((used));
+
+// Counts a sample, pc is the word address of the interrupted instruction
+void _pcprofRecord(uint16_t pc)
+{
+	uint16_t bucket = uint16_t(pc - pcprof_start) >> pcprof_shift;
+	uint16_t* counter = pc >= pcprof_start && bucket < PCPROF_BUCKETS ? &pcprof_histogram[bucket] : &pcprof_outside;
+	if(*counter != 0xFFFF){
+		++*counter;
+	}
+}
+
+void PCProf::setRange(uint32_t start, uint32_t end)
+{
+	uint16_t first = start >> 1;
+	uint32_t words = (end - start + 1) >> 1;
+	uint8_t shift = 0;
+	while((uint32_t(PCPROF_BUCKETS) << shift) < words){
+		++shift;
+	}
+	disable_interrupts;
+	pcprof_start = first;
+	pcprof_shift = shift;
+	pcprof_outside = 0;
+	for(uint16_t i = 0; i < PCPROF_BUCKETS; ++i){
+		pcprof_histogram[i] = 0;
+	}
+	pcprof_rangeSet = true;
+	restore_interrupts;
+}
+
+bool PCProf::start(uint16_t hz)
+{
+	if(hz == 0){
+		return false;
+	}
+	if(!pcprof_rangeSet){
+		setRange(0, FLASHEND + 1UL);
+	}
+	// CTC: f = F_CPU / (prescaler * (OCR2A + 1))
+	bool slow = hz < F_CPU/(256UL*256);
+	uint16_t ocr = (slow ? F_CPU/1024 : F_CPU/256) / hz - 1;
+	Timer<2>::disable();
+	Timer<2>::setCompare(TIMER_CH_A, ocr > 0xFF ? 0xFF : ocr);
+	Timer<2>::setCount(0);
+	Timer<2>::enableInterrupt(TIMER_INT_COMPA);
+	Timer<2>::enable(TIMER8_CTC, slow ? TIMER2_CLK_1024 : TIMER2_CLK_256);
+	return true;
+}
+
+void PCProf::stop()
+{
+	Timer<2>::disable();
+}
+
+void PCProf::service(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId)
+{
+	// Header: [CLASS:1 ID:1 LENGTH:2 START:2 SHIFT:1 FIRST:1 COUNT:1 OUTSIDE:2]
+	uint8_t msg[4 + 7 + 2*PCPROF_CHUNK];
+	uint8_t first = pcprof_next;
+	uint8_t count = PCPROF_BUCKETS - first < PCPROF_CHUNK ? PCPROF_BUCKETS - first : PCPROF_CHUNK;
+	uint16_t length = 4 + 7 + 2*count;
+	if(!Message::canSend(uart, length)){
+		return;
+	}
+	msg[0] = msgClass;
+	msg[1] = msgId;
+	*(uint16_t*)(msg + 2) = length - 4;
+	msg[7] = first;
+	msg[8] = count;
+	uint16_t* samples = (uint16_t*)(msg + 11);
+
+	// Read and clear the counters
+	disable_interrupts;
+	*(uint16_t*)(msg + 4) = pcprof_start << 1;
+	msg[6] = pcprof_shift + 1;
+	*(uint16_t*)(msg + 9) = first == 0 ? pcprof_outside : 0;
+	if(first == 0){
+		pcprof_outside = 0;
+	}
+	for(uint8_t i = 0; i < count; ++i){
+		samples[i] = pcprof_histogram[first + i];
+		pcprof_histogram[first + i] = 0;
+	}
+	restore_interrupts;
+
+	Message::send(uart, sig, msg, length);
+	pcprof_next = first + count < PCPROF_BUCKETS ? first + count : 0;
+}
+
+// The register layout of the frame is known, hence the handler is naked:
+// the return address is stored big-endian above the 15 saved bytes.
+ISR(TIMER2_COMPA_vect, ISR_NAKED)
+{
+	__asm__ __volatile__(
+		"push r0"              "\n\t"
+		"in r0, __SREG__"      "\n\t"
+		"push r0"              "\n\t"
+		"push r1"              "\n\t"
+		"clr r1"               "\n\t"
+		"push r18"             "\n\t"
+		"push r19"             "\n\t"
+		"push r20"             "\n\t"
+		"push r21"             "\n\t"
+		"push r22"             "\n\t"
+		"push r23"             "\n\t"
+		"push r24"             "\n\t"
+		"push r25"             "\n\t"
+		"push r26"             "\n\t"
+		"push r27"             "\n\t"
+		"push r30"             "\n\t"
+		"push r31"             "\n\t"
+		"in r30, __SP_L__"     "\n\t"
+		"in r31, __SP_H__"     "\n\t"
+		"ldd r25, Z+16"        "\n\t" // Return address, high byte
+		"ldd r24, Z+17"        "\n\t" // Return address, low byte
+		"call _pcprofRecord"   "\n\t"
+		"pop r31"              "\n\t"
+		"pop r30"              "\n\t"
+		"pop r27"              "\n\t"
+		"pop r26"              "\n\t"
+		"pop r25"              "\n\t"
+		"pop r24"              "\n\t"
+		"pop r23"              "\n\t"
+		"pop r22"              "\n\t"
+		"pop r21"              "\n\t"
+		"pop r20"              "\n\t"
+		"pop r19"              "\n\t"
+		"pop r18"              "\n\t"
+		"pop r1"               "\n\t"
+		"pop r0"               "\n\t"
+		"out __SREG__, r0"     "\n\t"
+		"pop r0"               "\n\t"
+		"reti"                 "\n\t"
+	);
+}
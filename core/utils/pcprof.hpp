@@ -0,0 +1,69 @@
+/** @file pcprof.hpp
+ *  @brief Statistical program counter sampling profiler
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef PCPROF_HPP
+#define PCPROF_HPP
+
+#include <common.hpp>
+
+class UART;
+
+/** Number of histogram buckets (at most 256, two bytes of SRAM each) */
+#ifndef PCPROF_BUCKETS
+#define PCPROF_BUCKETS 128
+#endif
+
+/** Statistical profiler
+ *  The compare A interrupt of timer 2 reads the return address of the
+ *  interrupted code from the stack and counts it in a histogram of flash
+ *  address ranges. The histogram is streamed over a UART as messages
+ *  (@see message.hpp) and symbolised on the host with tools/pcprof.py and
+ *  the ELF file of the program ($(BUILDDIR)/$(NAME).bin):
+ *  @code
+ *  tools/pcprof.py -e build-atmega640-imutest/imutest.bin /dev/ttyUSB0
+ *  @endcode
+ *
+ *  Code running with interrupts disabled (including other interrupt
+ *  handlers) is only sampled when it ends, hence is attributed to the
+ *  following instruction. Timer 2 must not be used for other purposes,
+ *  the interrupt handler replaces the TIMER2_COMPA handler of timers.cpp.
+ *
+ *  Message payload:
+ *  [START:2 SHIFT:1 FIRST:1 COUNT:1 OUTSIDE:2 SAMPLES:2*COUNT]
+ *  where START is the byte address of bucket 0, SHIFT the log2 of the bucket
+ *  size in bytes, FIRST the index of the first bucket of the message, and
+ *  OUTSIDE the number of samples outside the range. Counts are sent as
+ *  deltas: the histogram is cleared as it is sent.
+ */
+namespace PCProf {
+	/** Restrict the profiled flash range, defaults to the whole flash
+	 * @param start The first byte address
+	 * @param end The last byte address + 1
+	 */
+	void setRange(uint32_t start, uint32_t end);
+
+	/** Start sampling
+	 * @param hz The sampling rate, in [62, 10000]. Choose a rate which is not a
+	 *           multiple of periodic tasks to avoid aliasing.
+	 * @return false if hz is 0, true otherwise
+	 */
+	bool start(uint16_t hz = 997);
+
+	/** Stop sampling */
+	void stop();
+
+	/** Send the next part of the histogram if the transmit buffer has room
+	 *  Call periodically, each call sends at most one message.
+	 * @param uart The uart port
+	 * @param sig The message start signature
+	 * @param msgClass The message class
+	 * @param msgId The message id
+	 */
+	void service(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId);
+}
+
+#endif // PCPROF_HPP
@@ -0,0 +1,103 @@
+/** @file profiler.cpp
+ *  @brief Scope-based cycle count profiler
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "profiler.hpp"
+
+#ifdef PROFILING
+
+#include <axon/timers.hpp>
+
+#define TOV_BIT 0 // Overflow flag in TIFRn
+
+typedef TimerRegs<PROFILER_TIMER> ProfilerRegs;
+
+static Profiler::Probe profiler_end;                // Terminates the list of probes
+static Profiler::Probe* profiler_probes = &profiler_end;
+static volatile uint16_t profiler_overflows;
+static uint16_t profiler_overhead;
+
+static void _profilerOverflow()
+{
+	++profiler_overflows;
+}
+
+void Profiler::init()
+{
+	Timer<PROFILER_TIMER>::setCallback(TIMER_INT_OVF, _profilerOverflow);
+	Timer<PROFILER_TIMER>::enable(TIMER16_NORMAL, TIMER_CLK_1);
+
+	// Calibrate with an empty scope
+	profiler_overhead = 0;
+	uint16_t overhead = 0xFFFF;
+	for(uint8_t i = 0; i < 8; ++i){
+		uint32_t start = cycles();
+		uint32_t stop = cycles();
+		if(stop - start < overhead){
+			overhead = stop - start;
+		}
+	}
+	profiler_overhead = overhead;
+}
+
+uint32_t Profiler::cycles()
+{
+	disable_interrupts;
+	uint16_t tcnt = ProfilerRegs::TCNT();
+	uint16_t ovf = profiler_overflows;
+	// Overflow not serviced yet, and the counter was read after it
+	if(bit_is_set(ProfilerRegs::TIFR(), TOV_BIT) && tcnt < 0x8000){
+		++ovf;
+	}
+	restore_interrupts;
+	return (uint32_t(ovf) << 16) | tcnt;
+}
+
+void Profiler::record(Probe& probe, uint32_t cycles)
+{
+	cycles = cycles > profiler_overhead ? cycles - profiler_overhead : 0;
+	disable_interrupts;
+	if(probe.next == 0){
+		probe.next = profiler_probes;
+		profiler_probes = &probe;
+	}
+	++probe.count;
+	probe.total += cycles;
+	if(cycles < probe.min){
+		probe.min = cycles;
+	}
+	if(cycles > probe.max){
+		probe.max = cycles;
+	}
+	restore_interrupts;
+}
+
+void Profiler::reset()
+{
+	for(Probe* probe = profiler_probes; probe != &profiler_end; probe = probe->next){
+		disable_interrupts;
+		probe->count = 0;
+		probe->min = 0xFFFFFFFF;
+		probe->max = 0;
+		probe->total = 0;
+		restore_interrupts;
+	}
+}
+
+void Profiler::dump(FILE* out)
+{
+	fprintf_P(out, PSTR("%-24s %8s %8s %8s %8s %12s\n"), "probe", "count", "min", "max", "avg", "kcycles");
+	for(Probe* probe = profiler_probes; probe != &profiler_end; probe = probe->next){
+		disable_interrupts;
+		Probe copy = *probe;
+		restore_interrupts;
+		uint32_t avg = copy.count != 0 ? copy.total / copy.count : 0;
+		fprintf_P(out, PSTR("%-24S %8lu %8lu %8lu %8lu %12lu\n"), copy.name, copy.count,
+		          copy.count != 0 ? copy.min : 0, copy.max, avg, uint32_t(copy.total/1000));
+	}
+}
+
+#endif // PROFILING
@@ -0,0 +1,110 @@
+/** @file profiler.hpp
+ *  @brief Scope-based cycle count profiler
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <common.hpp>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+
+/** Timer counting the CPU cycles (one of 1, 3, 4 and 5) */
+#ifndef PROFILER_TIMER
+#define PROFILER_TIMER 5
+#endif
+
+/** Scope profiler
+ *  The profiler is enabled by defining PROFILING (i.e. add -DPROFILING to
+ *  CFLAGS and utils/profiler.cpp to SOURCES), otherwise the macros expand
+ *  to nothing and profiler.cpp is empty.
+ *
+ *  A probe accumulates the number of calls and the minimum, maximum and
+ *  total number of CPU cycles spent in a scope. PROFILER_TIMER runs
+ *  at F_CPU, extended to 32 bits with its overflow interrupt, hence scopes
+ *  of up to 268 s at 16 MHz are measured. The cost of a measurement is
+ *  calibrated by init() and subtracted, time spent in interrupts occurring
+ *  inside a scope is included.
+ *
+ *  Example:
+ *  @code
+ *  void UART::transmitService(){
+ *  	PROFILE_HERE(); // or PROFILE_SCOPE("uart tx")
+ *  	...
+ *  }
+ *
+ *  Profiler::init();
+ *  ...
+ *  FILE out = UART1.setupWriteStream();
+ *  Profiler::dump(&out); // name, count, min, max, avg, total/1000
+ *  @endcode
+ */
+namespace Profiler {
+	/** Probe statistics, one static instance per profiled scope */
+	struct Probe {
+		const char* name;  //!< Name of the probe (in program memory)
+		Probe* next;       //!< Next registered probe, 0 if not registered yet
+		uint32_t count;    //!< Number of measurements
+		uint32_t min;      //!< Minimum cycles
+		uint32_t max;      //!< Maximum cycles
+		uint64_t total;    //!< Total cycles
+	};
+
+	/** Start the cycle counter and calibrate the measurement overhead */
+	void init();
+
+	/** Return the current cycle count */
+	uint32_t cycles();
+
+	/** Add a measurement to a probe (registers the probe on first use)
+	 * @param probe The probe
+	 * @param cycles The measured number of cycles
+	 */
+	void record(Probe& probe, uint32_t cycles);
+
+	/** Clear the statistics of all probes */
+	void reset();
+
+	/** Print the statistics of all probes to the specified stream
+	 * @param out The output stream
+	 */
+	void dump(FILE* out);
+
+	/** Measures the lifetime of the object */
+	class Scope {
+	public:
+		Scope(Probe& probe) : m_probe(probe), m_start(cycles()) {}
+		~Scope(){ record(m_probe, cycles() - m_start); }
+
+	private:
+		Probe& m_probe;
+		uint32_t m_start;
+	};
+}
+
+#define PROFILER_CONCAT2(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT2(a, b)
+
+#ifdef PROFILING
+/** Profile the rest of the enclosing scope under the specified name */
+#define PROFILE_SCOPE(name) \
+	static const char PROFILER_CONCAT(_profName, __LINE__)[] PROGMEM = name; \
+	static Profiler::Probe PROFILER_CONCAT(_profProbe, __LINE__) = { PROFILER_CONCAT(_profName, __LINE__), 0, 0, 0xFFFFFFFF, 0, 0 }; \
+	Profiler::Scope PROFILER_CONCAT(_profScope, __LINE__)(PROFILER_CONCAT(_profProbe, __LINE__))
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#define PROFILER_STRINGIFY2(x) #x
+#define PROFILER_STRINGIFY(x) PROFILER_STRINGIFY2(x)
+
+/** Profile the rest of the enclosing scope, named by its source location (file:line)
+ *  The name is stored in program memory, which requires a string literal:
+ *  __func__ is not one, use PROFILE_SCOPE to name a probe after its function.
+ */
+#define PROFILE_HERE() PROFILE_SCOPE(__FILE__ ":" PROFILER_STRINGIFY(__LINE__))
+
+#endif // PROFILER_HPP
@@ -0,0 +1,122 @@
+/** @file pt.hpp
+ *  @brief Stackless coroutines (protothreads) for non-blocking drivers
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef PT_HPP
+#define PT_HPP
+
+#include <common.hpp>
+#include <axon/timer.hpp>
+
+/** Protothread state
+ *  A protothread is a function which is written sequentially but returns
+ *  to the caller whenever it waits, and continues where it left off on the
+ *  next call. The resume point is the source line of the wait, stored in
+ *  a switch label, hence there is no separate stack: local variables are
+ *  not preserved across waits (keep them in the object or in static
+ *  storage), and a protothread must not use switch statements spanning
+ *  a wait.
+ *
+ *  Waits on time use Timer1::ticks(), Timer1 must be enabled. Waits on
+ *  software timers or scheduler events use PT_WAIT_UNTIL, i.e.
+ *  PT_WAIT_UNTIL(pt, timer.expired()).
+ *
+ *  Example:
+ *  @code
+ *  uint8_t blink(PT* pt){
+ *  	PT_BEGIN(pt);
+ *  	for(;;){
+ *  		sbi(PORTB, 7);
+ *  		PT_WAIT_MS(pt, 100);
+ *  		cbi(PORTB, 7);
+ *  		PT_WAIT_MS(pt, 900);
+ *  	}
+ *  	PT_END(pt);
+ *  }
+ *
+ *  static PT pt;
+ *  while(PT_SCHEDULE(blink(&pt))) { ... }
+ *  @endcode
+ */
+struct PT {
+	uint16_t lc;       //!< Resume point (source line), 0 at the start
+	uint32_t deadline; //!< Deadline of a pending time wait, in Timer1 ticks
+};
+
+/** Return values of a protothread function */
+enum {
+	PT_WAITING = 0, //!< Blocked in a wait
+	PT_YIELDED = 1, //!< Yielded voluntarily
+	PT_EXITED  = 2, //!< Exited with PT_EXIT
+	PT_ENDED   = 3  //!< Reached PT_END
+};
+
+/** Initialize (or reset) a protothread */
+#define PT_INIT(pt) (pt)->lc = 0
+
+/** Start of the protothread body */
+#define PT_BEGIN(pt) switch((pt)->lc){ case 0:
+
+/** End of the protothread body, the protothread restarts on the next call */
+#define PT_END(pt) } (pt)->lc = 0; return PT_ENDED
+
+/** Wait while the condition is false */
+#define PT_WAIT_UNTIL(pt, cond) \
+	do{ \
+		(pt)->lc = __LINE__; case __LINE__: \
+		if(!(cond)){ return PT_WAITING; } \
+	}while(0)
+
+/** Wait while the condition is true */
+#define PT_WAIT_WHILE(pt, cond) PT_WAIT_UNTIL(pt, !(cond))
+
+/** Return to the caller once */
+#define PT_YIELD(pt) \
+	do{ \
+		(pt)->lc = __LINE__; return PT_YIELDED; case __LINE__:; \
+	}while(0)
+
+/** Wait at least the specified number of Timer1 ticks */
+#define PT_WAIT_TICKS(pt, n) \
+	do{ \
+		(pt)->deadline = Timer1::ticks() + (n); \
+		PT_WAIT_UNTIL(pt, int32_t(Timer1::ticks() - (pt)->deadline) >= 0); \
+	}while(0)
+
+/** Wait at least the specified number of microseconds (rounded up to the Timer1 resolution) */
+#define PT_WAIT_US(pt, us) PT_WAIT_TICKS(pt, Timer1::microsToTicks(us) + 1)
+
+/** Wait at least the specified number of milliseconds */
+#define PT_WAIT_MS(pt, ms) PT_WAIT_US(pt, (ms)*1000UL)
+
+/** Run a child protothread until it exits or ends */
+#define PT_WAIT_THREAD(pt, thread) PT_WAIT_WHILE(pt, PT_SCHEDULE(thread))
+
+/** Initialize a child protothread and run it until it exits or ends */
+#define PT_SPAWN(pt, child, thread) \
+	do{ \
+		PT_INIT(child); \
+		PT_WAIT_THREAD(pt, thread); \
+	}while(0)
+
+/** Exit the protothread, it restarts on the next call */
+#define PT_EXIT(pt) \
+	do{ \
+		PT_INIT(pt); \
+		return PT_EXITED; \
+	}while(0)
+
+/** Restart the protothread from the beginning on the next call */
+#define PT_RESTART(pt) \
+	do{ \
+		PT_INIT(pt); \
+		return PT_WAITING; \
+	}while(0)
+
+/** Evaluates to true while the protothread is running (waiting or yielded) */
+#define PT_SCHEDULE(f) ((f) < PT_EXITED)
+
+#endif // PT_HPP
@@ -0,0 +1,161 @@
+/** @file scheduler.cpp
+ *  @brief Cooperative run-to-completion task scheduler
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "scheduler.hpp"
+#include <axon/ringbuffer.hpp>
+#include <axon/timer.hpp>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+
+struct Task {
+	Scheduler::TaskFunction func;
+	void* arg;
+	uint8_t priority;
+	uint8_t pending;        // Number of posts not yet run
+	Scheduler::Stats stats;
+};
+
+static Task scheduler_tasks[SCHEDULER_MAX_TASKS];
+static uint8_t scheduler_order[SCHEDULER_MAX_TASKS]; // Task ids by decreasing priority
+static uint8_t scheduler_count;
+static uint32_t scheduler_idleTicks;
+
+static uint8_t scheduler_queueData[SCHEDULER_QUEUE_SIZE];
+static CRingBuffer<uint8_t> scheduler_queue(scheduler_queueData, SCHEDULER_QUEUE_SIZE);
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint8_t Scheduler::addTask(TaskFunction func, void* arg, uint8_t priority)
+{
+	if(scheduler_count >= SCHEDULER_MAX_TASKS){
+		return INVALID_TASK;
+	}
+	uint8_t id = scheduler_count;
+	Task& task = scheduler_tasks[id];
+	task.func = func;
+	task.arg = arg;
+	task.priority = priority;
+	task.pending = 0;
+	// Insert after the tasks of equal or higher priority
+	uint8_t pos = id;
+	while(pos > 0 && scheduler_tasks[scheduler_order[pos - 1]].priority < priority){
+		scheduler_order[pos] = scheduler_order[pos - 1];
+		--pos;
+	}
+	scheduler_order[pos] = id;
+	++scheduler_count;
+	return id;
+}
+
+bool Scheduler::post(uint8_t id)
+{
+	// Interrupts do not nest, so the queue only needs protection against
+	// posts from the main context being interrupted
+	disable_interrupts;
+	bool ok = scheduler_queue.push(id);
+	restore_interrupts;
+	return ok;
+}
+
+void Scheduler::timerCallback(void* arg)
+{
+	post(uint8_t(uintptr_t(arg)));
+}
+
+bool Scheduler::runOnce()
+{
+	// Move the posts from the queue to the pending counts
+	uint8_t id;
+	while(scheduler_queue.pop(id)){
+		if(id >= scheduler_count){
+			continue;
+		}
+		Task& task = scheduler_tasks[id];
+		if(task.pending != 0xFF){
+			++task.pending;
+		}else{
+			++task.stats.dropped;
+		}
+	}
+
+	for(uint8_t i = 0; i < scheduler_count; ++i){
+		Task& task = scheduler_tasks[scheduler_order[i]];
+		if(task.pending == 0){
+			continue;
+		}
+		--task.pending;
+		uint32_t start = Timer1::ticks();
+		task.func(task.arg);
+		uint32_t ticks = Timer1::ticks() - start;
+		++task.stats.runs;
+		task.stats.totalTicks += ticks;
+		if(ticks > task.stats.maxTicks){
+			task.stats.maxTicks = ticks > 0xFFFF ? 0xFFFF : ticks;
+		}
+		return true;
+	}
+	return false;
+}
+
+void Scheduler::run()
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	for(;;){
+		if(runOnce()){
+			continue;
+		}
+		// Sleep unless a post arrived in the meantime. The instruction
+		// following sei is executed before any pending interrupt, hence
+		// no wake-up can be lost between the check and the sleep.
+		cli();
+		if(scheduler_queue.empty()){
+			uint32_t start = Timer1::ticks();
+			sleep_enable();
+			sei();
+			sleep_cpu();
+			sleep_disable();
+			scheduler_idleTicks += Timer1::ticks() - start;
+		}
+		sei();
+	}
+}
+
+Scheduler::Stats Scheduler::stats(uint8_t id)
+{
+	return scheduler_tasks[id].stats;
+}
+
+uint32_t Scheduler::idleTicks()
+{
+	return scheduler_idleTicks;
+}
+
+uint16_t Scheduler::queueOverruns()
+{
+	return scheduler_queue.overruns();
+}
+
+void Scheduler::resetStats()
+{
+	for(uint8_t id = 0; id < scheduler_count; ++id){
+		Stats& stats = scheduler_tasks[id].stats;
+		stats.runs = stats.dropped = stats.maxTicks = 0;
+		stats.totalTicks = 0;
+	}
+	scheduler_idleTicks = 0;
+}
+
+void Scheduler::dump(FILE* out)
+{
+	fprintf_P(out, PSTR("id prio  runs drop    max      total\n"));
+	for(uint8_t id = 0; id < scheduler_count; ++id){
+		const Task& task = scheduler_tasks[id];
+		fprintf_P(out, PSTR("%2u %4u %5u %4u %6u %10lu\n"), id, task.priority, task.stats.runs,
+		          task.stats.dropped, task.stats.maxTicks, task.stats.totalTicks);
+	}
+	fprintf_P(out, PSTR("idle %lu, queue overruns %u\n"), scheduler_idleTicks, queueOverruns());
+}
@@ -0,0 +1,113 @@
+/** @file scheduler.hpp
+ *  @brief Cooperative run-to-completion task scheduler
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <common.hpp>
+#include <stdio.h>
+
+/** Maximum number of tasks */
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 16
+#endif
+
+/** Size of the post queue (power of two, at most 256) */
+#ifndef SCHEDULER_QUEUE_SIZE
+#define SCHEDULER_QUEUE_SIZE 32
+#endif
+
+/** Cooperative event loop
+ *  Tasks are functions which run to completion. A task runs once per post;
+ *  posts are accepted from any context (including interrupts) and travel
+ *  through an interrupt-safe queue of task ids to the main loop. The queue
+ *  is protected by a short critical section: post() disables interrupts
+ *  while it appends an id. Among the posted tasks, the one with the highest
+ *  priority runs first, tasks of equal priority run in the order they were
+ *  added. The latency of a task is therefore bounded by the longest running
+ *  task plus the tasks of higher priority: keep control tasks at high
+ *  priority, and split long work (i.e. display updates) into short tasks
+ *  which repost themselves.
+ *
+ *  When no task is pending, the CPU sleeps in SLEEP_MODE_IDLE until the
+ *  next interrupt. Run-time statistics are collected in Timer1 ticks,
+ *  Timer1 must be enabled for them to be meaningful.
+ *
+ *  Example:
+ *  @code
+ *  static void control(void*){ ... }
+ *
+ *  uint8_t id = Scheduler::addTask(control, 0, 10);
+ *  static CSoftTimer controlTimer(Scheduler::timerCallback, Scheduler::taskArg(id));
+ *  controlTimer.startPeriodic(10000); // post every 10 ms
+ *  Scheduler::run();
+ *  @endcode
+ */
+namespace Scheduler {
+	/** A task function */
+	typedef void (*TaskFunction)(void* arg);
+
+	/** Task run-time statistics */
+	struct Stats {
+		uint16_t runs;       //!< Number of runs
+		uint16_t dropped;    //!< Number of posts lost because the pending count saturated
+		uint16_t maxTicks;   //!< Longest run, in Timer1 ticks (saturating)
+		uint32_t totalTicks; //!< Total run time, in Timer1 ticks
+	};
+
+	/** Invalid task id */
+	static const uint8_t INVALID_TASK = 0xFF;
+
+	/** Add a task
+	 * @param func The task function
+	 * @param arg The argument passed to the task function
+	 * @param priority The task priority, higher values run first
+	 * @return The task id, or INVALID_TASK if the task table is full
+	 */
+	uint8_t addTask(TaskFunction func, void* arg, uint8_t priority);
+
+	/** Post a task, i.e. request it to run once. Interrupt safe.
+	 * @param id The task id
+	 * @return false if the post queue is full
+	 */
+	bool post(uint8_t id);
+
+	/** CSoftTimer callback which posts the task passed as argument, @see taskArg */
+	void timerCallback(void* arg);
+
+	/** Return the argument for timerCallback which posts the specified task */
+	inline void* taskArg(uint8_t id){ return reinterpret_cast<void*>(uintptr_t(id)); }
+
+	/** Run the highest priority pending task, if any
+	 * @return true if a task was run
+	 */
+	bool runOnce();
+
+	/** Run the event loop, sleeping while idle. Does not return. */
+	void run() __attribute__((noreturn));
+
+	/** Return the run-time statistics of a task
+	 * @param id The task id
+	 */
+	Stats stats(uint8_t id);
+
+	/** Return the time spent sleeping, in Timer1 ticks */
+	uint32_t idleTicks();
+
+	/** Return the number of posts lost because the post queue was full */
+	uint16_t queueOverruns();
+
+	/** Reset all statistics */
+	void resetStats();
+
+	/** Print the task statistics to the specified stream
+	 * @param out The output stream
+	 */
+	void dump(FILE* out);
+}
+
+#endif // SCHEDULER_HPP
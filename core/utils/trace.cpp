@@ -0,0 +1,46 @@
+/** @file trace.cpp
+ *  @brief Binary event trace of interrupts and tasks
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "trace.hpp"
+
+#ifdef TRACING
+
+#include "message.hpp"
+#include <axon/timer.hpp>
+
+#define TRACE_CHUNK 24 // Events per message
+
+static Trace::Event trace_events[TRACE_SIZE];
+CRingBuffer<Trace::Event> Trace::_buffer(trace_events, TRACE_SIZE);
+static uint16_t trace_lost; // Overruns already reported
+
+void Trace::service(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId)
+{
+	// Header: [CLASS:1 ID:1 LENGTH:2 NOW:4 US_PER_WRAP:4 LOST:2]
+	uint8_t msg[4 + 10 + 4*TRACE_CHUNK];
+	uint8_t count = _buffer.size() < TRACE_CHUNK ? _buffer.size() : TRACE_CHUNK;
+	uint16_t overruns = _buffer.overruns();
+	if(count == 0 && overruns == trace_lost){
+		return;
+	}
+	uint16_t length = 4 + 10 + 4*count;
+	if(!Message::canSend(uart, length)){
+		return;
+	}
+	msg[0] = msgClass;
+	msg[1] = msgId;
+	*(uint16_t*)(msg + 2) = length - 4;
+	// Take the time stamp after the events, so that it is not older than any of them
+	_buffer.read((Event*)(msg + 14), count);
+	*(uint32_t*)(msg + 4) = Timer1::ticks();
+	*(uint32_t*)(msg + 8) = Timer1::ticksToMicros(65536UL);
+	*(uint16_t*)(msg + 12) = overruns - trace_lost;
+	trace_lost = overruns;
+	Message::send(uart, sig, msg, length);
+}
+
+#endif // TRACING
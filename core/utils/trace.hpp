@@ -0,0 +1,110 @@
+/** @file trace.hpp
+ *  @brief Binary event trace of interrupts and tasks
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <common.hpp>
+#include <axon/ringbuffer.hpp>
+
+class UART;
+
+/** Number of events of the trace buffer (power of two, at most 256) */
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 128
+#endif
+
+/** Event tracer
+ *  Tracing is enabled by defining TRACING (i.e. add -DTRACING to CFLAGS
+ *  and utils/trace.cpp to SOURCES), otherwise the TRACE_ macros expand to
+ *  nothing.
+ *
+ *  An event is four bytes: the event id (6 bits) and phase (2 bits), an
+ *  8-bit argument and the low 16 bits of the Timer1 counter. Recording is
+ *  inline and takes a few cycles, events can be recorded from interrupts
+ *  and from the main context. When the buffer is full, events are dropped
+ *  and counted.
+ *
+ *  The buffer is drained over a UART as messages (@see message.hpp) and
+ *  converted with tools/trace2json.py to the Chrome trace JSON format,
+ *  which can be opened with chrome://tracing or ui.perfetto.dev. The host
+ *  reconstructs the timestamps from the drain time, hence service() must
+ *  be called more often than the Timer1 counter wraps (262 ms with
+ *  Timer1::CLK_64).
+ *
+ *  Message payload: [NOW:4 US_PER_WRAP:4 LOST:2 EVENTS:4*N]
+ *  where NOW is Timer1::ticks() at the time of sending, US_PER_WRAP the
+ *  duration of 65536 ticks in microseconds, LOST the number of events
+ *  dropped since the previous message, and each event [ID:1 ARG:1 TIME:2].
+ *
+ *  Example:
+ *  @code
+ *  enum { EV_UART_RX = 1, EV_ADC = 2, EV_DISPLAY = 3 };
+ *  ISR(ADC_vect){ TRACE_INSTANT(EV_ADC, ADCH); ... }
+ *  void updateDisplay(){ TRACE_BEGIN(EV_DISPLAY, 0); ... TRACE_END(EV_DISPLAY, 0); }
+ *  @endcode
+ */
+namespace Trace {
+	/** Event phases (upper two bits of the id byte) */
+	enum EPhase {
+		PHASE_INSTANT = 0x00, //!< Point in time
+		PHASE_BEGIN   = 0x40, //!< Start of a duration
+		PHASE_END     = 0x80, //!< End of a duration
+		PHASE_COUNTER = 0xC0  //!< Value of a counter (the argument)
+	};
+
+	/** A trace event */
+	struct Event {
+		uint8_t id;    //!< Phase | event id
+		uint8_t arg;   //!< Event argument
+		uint16_t time; //!< Low 16 bits of the Timer1 counter
+	};
+
+	/** The event buffer, use the TRACE_ macros to record events */
+	extern CRingBuffer<Event> _buffer;
+
+	/** Record an event
+	 * @param id The event phase | event id
+	 * @param arg The event argument
+	 */
+	inline void record(uint8_t id, uint8_t arg){
+		Event event;
+		event.id = id;
+		event.arg = arg;
+		disable_interrupts;
+		event.time = TCNT1;
+		_buffer.push(event);
+		restore_interrupts;
+	}
+
+	/** Send buffered events if the transmit buffer has room
+	 *  Call periodically, each call sends at most one message.
+	 * @param uart The uart port
+	 * @param sig The message start signature
+	 * @param msgClass The message class
+	 * @param msgId The message id
+	 */
+	void service(UART& uart, const uint8_t sig[2], uint8_t msgClass, uint8_t msgId);
+}
+
+#ifdef TRACING
+/** Record an instant event */
+#define TRACE_INSTANT(id, arg) Trace::record(Trace::PHASE_INSTANT | ((id) & 0x3F), (arg))
+/** Record the beginning of a duration */
+#define TRACE_BEGIN(id, arg) Trace::record(Trace::PHASE_BEGIN | ((id) & 0x3F), (arg))
+/** Record the end of a duration */
+#define TRACE_END(id, arg) Trace::record(Trace::PHASE_END | ((id) & 0x3F), (arg))
+/** Record a counter value */
+#define TRACE_COUNTER(id, value) Trace::record(Trace::PHASE_COUNTER | ((id) & 0x3F), (value))
+#else
+#define TRACE_INSTANT(id, arg)
+#define TRACE_BEGIN(id, arg)
+#define TRACE_END(id, arg)
+#define TRACE_COUNTER(id, value)
+#endif
+
+#endif // TRACE_HPP
@@ -0,0 +1,121 @@
+/** @file ubx.cpp
+ *  @brief Streaming parser for u-blox UBX messages
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#include "ubx.hpp"
+#include <axon/uart.hpp>
+
+#define UBX_SYNC1 0xB5
+#define UBX_SYNC2 0x62
+
+enum EState { STATE_SYNC1, STATE_SYNC2, STATE_CLASS, STATE_ID, STATE_LEN1, STATE_LEN2, STATE_PAYLOAD, STATE_CK_A, STATE_CK_B };
+
+UBX::Parser::Parser()
+	: m_nSubscriptions(0), m_state(STATE_SYNC1), m_class(0), m_id(0), m_length(0), m_pos(0), m_maxLength(0), m_dest(0),
+	  m_ckA(0), m_ckB(0), m_checksumErrors(0)
+{
+}
+
+bool UBX::Parser::subscribe(uint8_t cls, uint8_t id, void* dest, uint16_t size)
+{
+	if(m_nSubscriptions >= MAX_SUBSCRIPTIONS){
+		return false;
+	}
+	Subscription& s = m_subscriptions[m_nSubscriptions++];
+	s.cls = cls;
+	s.id = id;
+	s.dest = static_cast<uint8_t*>(dest);
+	s.size = size;
+	if(size > m_maxLength){
+		m_maxLength = size;
+	}
+	return true;
+}
+
+bool UBX::Parser::parse(uint8_t byte)
+{
+	// The checksum covers class, id, length and payload
+	if(m_state >= STATE_CLASS && m_state <= STATE_PAYLOAD){
+		m_ckA += byte;
+		m_ckB += m_ckA;
+	}
+	switch(m_state){
+	case STATE_SYNC1:
+		if(byte == UBX_SYNC1){ m_state = STATE_SYNC2; }
+		break;
+	case STATE_SYNC2:
+		m_state = byte == UBX_SYNC2 ? STATE_CLASS : byte == UBX_SYNC1 ? STATE_SYNC2 : STATE_SYNC1;
+		m_ckA = m_ckB = 0;
+		break;
+	case STATE_CLASS:
+		m_class = byte;
+		m_state = STATE_ID;
+		break;
+	case STATE_ID:
+		m_id = byte;
+		m_state = STATE_LEN1;
+		break;
+	case STATE_LEN1:
+		m_length = byte;
+		m_state = STATE_LEN2;
+		break;
+	case STATE_LEN2:
+		m_length |= uint16_t(byte) << 8;
+		m_pos = 0;
+		// No subscription accepts it, and a corrupt length would stall the parser
+		if(m_length > m_maxLength){
+			m_state = STATE_SYNC1;
+			break;
+		}
+		// Look up destination, the payload of unsubscribed messages is only checksummed
+		m_dest = 0;
+		for(uint8_t i = 0; i < m_nSubscriptions; ++i){
+			const Subscription& s = m_subscriptions[i];
+			if(s.cls == m_class && s.id == m_id && m_length <= s.size){
+				m_dest = s.dest;
+				break;
+			}
+		}
+		m_state = m_length > 0 ? STATE_PAYLOAD : STATE_CK_A;
+		break;
+	case STATE_PAYLOAD:
+		if(m_dest != 0){
+			m_dest[m_pos] = byte;
+		}
+		if(++m_pos == m_length){
+			m_state = STATE_CK_A;
+		}
+		break;
+	case STATE_CK_A:
+		if(byte == m_ckA){
+			m_state = STATE_CK_B;
+		}else{
+			// The frame was corrupt, the byte may start the next one
+			++m_checksumErrors;
+			m_state = byte == UBX_SYNC1 ? STATE_SYNC2 : STATE_SYNC1;
+		}
+		break;
+	case STATE_CK_B:
+		if(byte != m_ckB){
+			++m_checksumErrors;
+			m_state = byte == UBX_SYNC1 ? STATE_SYNC2 : STATE_SYNC1;
+			return false;
+		}
+		m_state = STATE_SYNC1;
+		return m_dest != 0;
+	}
+	return false;
+}
+
+bool UBX::Parser::poll(UART& uart)
+{
+	while(!uart.receiveBufferEmpty()){
+		if(parse(uart.getByte())){
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,177 @@
+/** @file ubx.hpp
+ *  @brief Streaming parser for u-blox UBX messages
+ *  @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+ *  @section license
+ *  Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+ */
+
+#ifndef UBX_HPP
+#define UBX_HPP
+
+#include <common.hpp>
+
+class UART;
+
+/** UBX messages have the same structure as the messages of message.hpp:
+ * [SIG:2 CLASS:1 ID:1 LENGTH:2 PAYLOAD:LENGTH CHECKSUM:2], with SIG = 0xB5 0x62
+ */
+namespace UBX {
+	/** Message classes */
+	enum EClass {
+		CLASS_NAV = 0x01,
+		CLASS_ACK = 0x05,
+		CLASS_CFG = 0x06,
+		CLASS_MON = 0x0A
+	};
+
+	/** Message ids of the NAV class */
+	enum ENavId {
+		NAV_POSLLH = 0x02,
+		NAV_STATUS = 0x03,
+		NAV_SOL    = 0x06,
+		NAV_PVT    = 0x07,
+		NAV_VELNED = 0x12,
+		NAV_TIMEUTC = 0x21
+	};
+
+	/** NAV-POSLLH payload: geodetic position */
+	struct NavPosllh {
+		uint32_t iTOW;   //!< GPS time of week [ms]
+		int32_t lon;     //!< Longitude [1e-7 deg]
+		int32_t lat;     //!< Latitude [1e-7 deg]
+		int32_t height;  //!< Height above ellipsoid [mm]
+		int32_t hMSL;    //!< Height above mean sea level [mm]
+		uint32_t hAcc;   //!< Horizontal accuracy estimate [mm]
+		uint32_t vAcc;   //!< Vertical accuracy estimate [mm]
+	} __attribute__((packed));
+
+	/** NAV-VELNED payload: velocity in NED frame */
+	struct NavVelned {
+		uint32_t iTOW;   //!< GPS time of week [ms]
+		int32_t velN;    //!< North velocity [cm/s]
+		int32_t velE;    //!< East velocity [cm/s]
+		int32_t velD;    //!< Down velocity [cm/s]
+		uint32_t speed;  //!< 3D speed [cm/s]
+		uint32_t gSpeed; //!< Ground speed [cm/s]
+		int32_t heading; //!< Heading of motion [1e-5 deg]
+		uint32_t sAcc;   //!< Speed accuracy estimate [cm/s]
+		uint32_t cAcc;   //!< Course accuracy estimate [1e-5 deg]
+	} __attribute__((packed));
+
+	/** NAV-PVT payload: navigation position velocity time solution */
+	struct NavPvt {
+		uint32_t iTOW;     //!< GPS time of week [ms]
+		uint16_t year;     //!< Year (UTC)
+		uint8_t month;     //!< Month (UTC), 1..12
+		uint8_t day;       //!< Day of month (UTC), 1..31
+		uint8_t hour;      //!< Hour of day (UTC), 0..23
+		uint8_t min;       //!< Minute of hour (UTC), 0..59
+		uint8_t sec;       //!< Seconds of minute (UTC), 0..60
+		uint8_t valid;     //!< Validity flags
+		uint32_t tAcc;     //!< Time accuracy estimate [ns]
+		int32_t nano;      //!< Fraction of second [ns]
+		uint8_t fixType;   //!< 0: no fix, 2: 2D fix, 3: 3D fix
+		uint8_t flags;     //!< Fix status flags
+		uint8_t flags2;    //!< Additional flags
+		uint8_t numSV;     //!< Number of satellites used
+		int32_t lon;       //!< Longitude [1e-7 deg]
+		int32_t lat;       //!< Latitude [1e-7 deg]
+		int32_t height;    //!< Height above ellipsoid [mm]
+		int32_t hMSL;      //!< Height above mean sea level [mm]
+		uint32_t hAcc;     //!< Horizontal accuracy estimate [mm]
+		uint32_t vAcc;     //!< Vertical accuracy estimate [mm]
+		int32_t velN;      //!< North velocity [mm/s]
+		int32_t velE;      //!< East velocity [mm/s]
+		int32_t velD;      //!< Down velocity [mm/s]
+		int32_t gSpeed;    //!< Ground speed [mm/s]
+		int32_t headMot;   //!< Heading of motion [1e-5 deg]
+		uint32_t sAcc;     //!< Speed accuracy estimate [mm/s]
+		uint32_t headAcc;  //!< Heading accuracy estimate [1e-5 deg]
+		uint16_t pDOP;     //!< Position DOP [0.01]
+		uint8_t reserved1[6];
+		int32_t headVeh;   //!< Heading of vehicle [1e-5 deg]
+		int16_t magDec;    //!< Magnetic declination [1e-2 deg]
+		uint16_t magAcc;   //!< Magnetic declination accuracy [1e-2 deg]
+	} __attribute__((packed));
+
+	/** Incremental UBX parser
+	 * The payload of subscribed messages is written directly into the
+	 * destination structure while it is received, no intermediate buffer is
+	 * used. The contents of the destination are hence only consistent after
+	 * parse (or poll) returned true for the corresponding message, and until
+	 * the next message of the same type starts arriving. Frames with a
+	 * payload longer than the largest subscription are dropped right after
+	 * the length field, so that a corrupt length cannot stall the parser.
+	 * Example:
+	 * @code{.cpp}
+	 *   UBX::NavPvt pvt;
+	 *   UBX::Parser gps;
+	 *   gps.subscribe(UBX::CLASS_NAV, UBX::NAV_PVT, &pvt, sizeof(pvt));
+	 *   while(true){
+	 *     while(gps.poll(UART2)){
+	 *       if(gps.messageId() == UBX::NAV_PVT){ ... }
+	 *     }
+	 *   }
+	 * @endcode
+	 */
+	class Parser {
+	public:
+		/** Maximum number of subscriptions */
+		static const uint8_t MAX_SUBSCRIPTIONS = 4;
+
+		Parser();
+
+		/** Sets the destination for the payload of messages of the specified class and id
+		 * Messages with a payload longer than size are discarded.
+		 * @param cls The message class
+		 * @param id The message id
+		 * @param dest The destination structure
+		 * @param size The size of the destination structure
+		 * @return false if the maximum number of subscriptions was reached, true otherwise
+		 */
+		bool subscribe(uint8_t cls, uint8_t id, void* dest, uint16_t size);
+
+		/** Processes a byte
+		 * @param byte The received byte
+		 * @return true if the byte completed a valid subscribed message, false otherwise
+		 */
+		bool parse(uint8_t byte);
+
+		/** Processes the bytes in the receive buffer of the uart, until a
+		 * valid subscribed message is completed or the buffer is empty
+		 * @param uart The uart port
+		 * @return true if a valid subscribed message was completed, false otherwise
+		 */
+		bool poll(UART& uart);
+
+		/** Returns the class of the last completed message */
+		uint8_t messageClass() const{ return m_class; }
+
+		/** Returns the id of the last completed message */
+		uint8_t messageId() const{ return m_id; }
+
+		/** Returns the payload length of the last completed message */
+		uint16_t messageLength() const{ return m_length; }
+
+		/** Returns the number of messages discarded due to a checksum mismatch */
+		uint16_t checksumErrors() const{ return m_checksumErrors; }
+
+	private:
+		struct Subscription {
+			uint8_t cls, id;
+			uint8_t* dest;
+			uint16_t size;
+		};
+		Subscription m_subscriptions[MAX_SUBSCRIPTIONS];
+		uint8_t m_nSubscriptions;
+		uint8_t m_state;
+		uint8_t m_class, m_id;
+		uint16_t m_length, m_pos;
+		uint16_t m_maxLength;
+		uint8_t* m_dest;
+		uint8_t m_ckA, m_ckB;
+		uint16_t m_checksumErrors;
+	};
+}
+
+#endif
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+# @file logdecode.py
+# @brief Formats the deferred log records of core/utils/log.hpp
+# @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+# @section license
+# Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+#
+# Usage:
+#   logdecode.py -e ELF [-s SIG] [-c CLASS] [-i ID] FILE|DEVICE
+# Reads the log messages from a capture file (or serial device node
+# configured with stty) until end of file or Ctrl+C, looks up the format
+# strings in the .logstrings section of the ELF file ($(BUILDDIR)/$(NAME).bin)
+# and prints the formatted lines. The ELF file must be the one of the
+# running firmware, otherwise the site ids point to the wrong strings.
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from telemetry import read_messages
+
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|l)?([diouxXcsfFeEgGp%])")
+
+
+def read_section(elf, name):
+    """Returns the contents of the named section of a 32-bit little endian ELF file"""
+    with open(elf, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+        raise ValueError("%s is not a 32-bit little endian ELF file" % elf)
+    shoff, = struct.unpack_from("<I", data, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x2E)
+    sections = [struct.unpack_from("<IIIIII", data, shoff + i * shentsize) for i in range(shnum)]
+    strtab = sections[shstrndx][4]
+    for sh_name, sh_type, flags, addr, offset, size in sections:
+        end = data.index(b"\0", strtab + sh_name)
+        if data[strtab + sh_name:end].decode() == name:
+            return data[offset:offset + size]
+    raise ValueError("%s has no %s section" % (elf, name))
+
+
+def format_record(fmt, args):
+    """Formats the raw argument bytes args according to the printf format fmt"""
+    pos = 0
+
+    def take(code, size):
+        nonlocal pos
+        value, = struct.unpack_from(code, args, pos)
+        pos += size
+        return value
+
+    def convert(match):
+        nonlocal pos
+        flags, width, precision, length, conv = match.groups()
+        if conv == "%":
+            return "%"
+        if width == "*":
+            width = str(take("<h", 2))
+        if precision == "*":
+            precision = str(take("<h", 2))
+        spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+        if conv == "s":
+            end = args.index(b"\0", pos)
+            value = args[pos:end].decode("latin-1")
+            pos = end + 1
+        elif conv in "fFeEgG":
+            value = take("<f", 4)
+        elif conv == "c":
+            value = chr(take("<H", 2) & 0xFF)
+        elif conv == "p":
+            return (spec + "#x") % take("<H", 2)
+        elif conv in "di":
+            value = take("<l", 4) if length == "l" else take("<h", 2)
+        else:
+            value = take("<L", 4) if length == "l" else take("<H", 2)
+            conv = "d" if conv == "u" else conv
+        return (spec + conv) % value
+
+    try:
+        return CONVERSION.sub(convert, fmt)
+    except (struct.error, ValueError):
+        return "%s <bad arguments %s>" % (fmt, args.hex())
+
+
+def decode(payload, strings):
+    """Returns (time_ms, lost, [line]) of a log message"""
+    time, lost = struct.unpack_from("<IH", payload, 0)
+    lines = []
+    pos = 6
+    while pos + 3 <= len(payload):
+        site, length = struct.unpack_from("<HB", payload, pos)
+        args = payload[pos + 3:pos + 3 + length]
+        pos += 3 + length
+        if site >= len(strings):
+            lines.append("<unknown site %d: %s>" % (site, args.hex()))
+            continue
+        fmt = strings[site:strings.index(b"\0", site)].decode("latin-1")
+        lines.append(format_record(fmt, args))
+    return time, lost, lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Format Axon deferred log messages")
+    parser.add_argument("-e", "--elf", required=True, help="ELF file of the program, i.e. $(BUILDDIR)/$(NAME).bin")
+    parser.add_argument("-s", "--sig", default="b562", help="message signature, as hex (default: b562)")
+    parser.add_argument("-c", "--cls", type=lambda x: int(x, 0), default=0xF0, help="message class (default: 0xF0)")
+    parser.add_argument("-i", "--id", type=lambda x: int(x, 0), default=0x03, help="message id (default: 0x03)")
+    parser.add_argument("input", help="capture file or device node")
+    args = parser.parse_args()
+
+    strings = read_section(args.elf, ".logstrings")
+    try:
+        with open(args.input, "rb", buffering=0) as stream:
+            for cls, mid, payload in read_messages(stream, bytes.fromhex(args.sig)):
+                if (cls, mid) != (args.cls, args.id) or len(payload) < 6:
+                    continue
+                time, lost, lines = decode(payload, strings)
+                if lost:
+                    print("[%10.3f] <%d records lost>" % (time / 1000.0, lost))
+                for line in lines:
+                    print("[%10.3f] %s" % (time / 1000.0, line))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+# @file pcprof.py
+# @brief Host-side symbolisation of the sampling profiler core/utils/pcprof.hpp
+# @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+# @section license
+# Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+#
+# Usage:
+#   pcprof.py -e ELF [-s SIG] [-c CLASS] [-i ID] [-b] FILE|DEVICE
+# Accumulates the histogram messages read from a capture file (or serial
+# device node configured with stty) until end of file or Ctrl+C, then maps
+# the address ranges to the functions of the ELF file ($(BUILDDIR)/$(NAME).bin)
+# and prints the samples per function.
+
+import argparse
+import bisect
+import os
+import struct
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from telemetry import read_messages
+
+
+def read_symbols(elf, nm="avr-nm"):
+    """Returns the sorted list of (address, size, name) of the code symbols of elf"""
+    output = subprocess.check_output([nm, "-C", "-n", "-S", elf], universal_newlines=True)
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) == 4 and fields[2] in "tTwW":
+            symbols.append((int(fields[0], 16), int(fields[1], 16), fields[3]))
+    return symbols
+
+
+def attribute(histogram, symbols):
+    """Distributes the samples of each (start, size) range over the symbols
+    overlapping it, proportionally to the overlap. Returns {name: samples}."""
+    addresses = [s[0] for s in symbols]
+    result = {}
+    for (start, size), samples in histogram.items():
+        end = start + size
+        covered = 0
+        i = max(bisect.bisect_right(addresses, start) - 1, 0)
+        while i < len(symbols) and symbols[i][0] < end:
+            addr, length, name = symbols[i]
+            overlap = min(end, addr + length) - max(start, addr)
+            if overlap > 0:
+                result[name] = result.get(name, 0.0) + samples * overlap / size
+                covered += overlap
+            i += 1
+        if covered < size:
+            result["?"] = result.get("?", 0.0) + samples * (size - covered) / size
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Symbolise PC sampling profiles")
+    parser.add_argument("-e", "--elf", required=True, help="ELF file of the program, i.e. $(BUILDDIR)/$(NAME).bin")
+    parser.add_argument("-s", "--sig", default="b562", help="message signature, as hex (default: b562)")
+    parser.add_argument("-c", "--cls", type=lambda x: int(x, 0), default=0xF0, help="message class (default: 0xF0)")
+    parser.add_argument("-i", "--id", type=lambda x: int(x, 0), default=0x01, help="message id (default: 0x01)")
+    parser.add_argument("-b", "--buckets", action="store_true", help="also print the raw address ranges")
+    parser.add_argument("--nm", default="avr-nm", help="nm program (default: avr-nm)")
+    parser.add_argument("input", help="capture file or device node")
+    args = parser.parse_args()
+
+    histogram = {}
+    outside = 0
+    try:
+        with open(args.input, "rb", buffering=0) as stream:
+            for cls, mid, payload in read_messages(stream, bytes.fromhex(args.sig)):
+                if (cls, mid) != (args.cls, args.id) or len(payload) < 7:
+                    continue
+                start, shift, first, count, out = struct.unpack_from("<HBBBH", payload, 0)
+                outside += out
+                size = 1 << shift
+                for i, samples in enumerate(struct.unpack_from("<%dH" % count, payload, 7)):
+                    if samples:
+                        key = (start + (first + i) * size, size)
+                        histogram[key] = histogram.get(key, 0) + samples
+    except KeyboardInterrupt:
+        pass
+
+    total = sum(histogram.values()) + outside
+    if total == 0:
+        print("No samples")
+        return 1
+    if args.buckets:
+        for (start, size), samples in sorted(histogram.items()):
+            print("%06x-%06x %8d" % (start, start + size, samples))
+        print()
+    functions = attribute(histogram, read_symbols(args.elf, args.nm))
+    if outside:
+        functions["<outside range>"] = outside
+    print("%7s %9s  %s" % ("%", "samples", "function"))
+    for name, samples in sorted(functions.items(), key=lambda x: -x[1]):
+        print("%6.2f%% %9.1f  %s" % (100.0 * samples / total, samples, name))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+# @file telemetry.py
+# @brief Host-side decoding of messages sent with core/utils/message.hpp
+# @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+# @section license
+# Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+#
+# Usage:
+#   telemetry.py [-s SIG] [-c CHANNELS] FILE|DEVICE
+# Decodes the messages in a capture file (or serial device node configured
+# with stty) and prints them. With -c, payloads of batch messages
+# (core/utils/batch.hpp) are decoded as delta records (core/utils/delta.hpp)
+# with the specified number of channels.
+
+import argparse
+import struct
+import sys
+
+
+def checksum(data):
+    """8-bit Fletcher checksum, see compute_checksum in core/utils/message.cpp"""
+    c1 = c2 = 0
+    for b in data:
+        c1 = (c1 + b) & 0xFF
+        c2 = (c2 + c1) & 0xFF
+    return c1, c2
+
+
+def read_messages(stream, sig=b"\xb5\x62"):
+    """Yields (class, id, payload) tuples of the valid messages of the form
+    [SIG:2 CLASS:1 ID:1 LENGTH:2 PAYLOAD:LENGTH CHECKSUM:2] read from stream"""
+    buf = bytearray()
+    while True:
+        data = stream.read(256)
+        if not data:
+            return
+        buf += data
+        while True:
+            start = buf.find(sig)
+            if start < 0:
+                del buf[:-1]
+                break
+            if len(buf) < start + 6:
+                del buf[:start]
+                break
+            length, = struct.unpack_from("<H", buf, start + 4)
+            end = start + 6 + length + 2
+            if len(buf) < end:
+                del buf[:start]
+                break
+            msg = bytes(buf[start + 2:end - 2])
+            if checksum(msg) == tuple(buf[end - 2:end]):
+                yield msg[0], msg[1], msg[4:]
+                del buf[:end]
+            else:
+                del buf[:start + 1]
+
+
+def parse_batch(payload):
+    """Splits the payload of a batch message (core/utils/batch.hpp) into
+    (count, timestamp_ms, samples)"""
+    count, timestamp = struct.unpack_from("<BI", payload, 0)
+    return count, timestamp, payload[5:]
+
+
+def read_varint(data, pos):
+    """Reads a zigzag varint, returns (value, newpos)"""
+    zz = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        zz |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return (zz >> 1) ^ -(zz & 1), pos
+
+
+class DeltaDecoder:
+    """Counterpart of Delta::Decoder, see core/utils/delta.hpp"""
+
+    def __init__(self, channels):
+        self.channels = channels
+        self.state = [0] * channels
+        self.seq = 0
+        self.synced = False
+
+    def decode(self, data):
+        """Yields the samples (lists of channel values) of the concatenated records in data.
+        Records which cannot be decoded since a record was lost are skipped. A
+        truncated record ends the data, decoding resumes at the next keyframe."""
+        pos = 0
+        while pos < len(data):
+            header = data[pos]
+            keyframe = bool(header & 0x80)
+            seq = header & 0x7F
+            self.synced = keyframe or (self.synced and seq == self.seq)
+            self.seq = (seq + 1) & 0x7F
+            pos += 1
+            values = []
+            for i in range(self.channels):
+                try:
+                    value, pos = read_varint(data, pos)
+                except IndexError:
+                    self.synced = False
+                    return
+                if not keyframe:
+                    value = self.state[i] + value
+                values.append(((value + 0x8000) & 0xFFFF) - 0x8000)
+            if self.synced:
+                self.state = values
+                yield values
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode Axon messages")
+    parser.add_argument("-s", "--sig", default="b562", help="message signature, as hex (default: b562)")
+    parser.add_argument("-c", "--channels", type=int, help="decode batch payloads as delta records with CHANNELS channels")
+    parser.add_argument("input", help="capture file or device node")
+    args = parser.parse_args()
+
+    decoders = {}
+    with open(args.input, "rb", buffering=0) as stream:
+        for cls, mid, payload in read_messages(stream, bytes.fromhex(args.sig)):
+            if args.channels is None:
+                print("%02x:%02x %s" % (cls, mid, payload.hex()))
+                continue
+            count, timestamp, data = parse_batch(payload)
+            decoder = decoders.setdefault((cls, mid), DeltaDecoder(args.channels))
+            for values in decoder.decode(data):
+                print("%02x:%02x %d %s" % (cls, mid, timestamp, " ".join(str(v) for v in values)))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+# @file trace2json.py
+# @brief Converts event traces of core/utils/trace.hpp to Chrome trace JSON
+# @copyright (C) 2012-2013 Sandro Mani manisandro@gmail.com
+# @section license
+# Distributed under the GNU Public License, see http://www.gnu.org/licenses/gpl.txt
+#
+# Usage:
+#   trace2json.py [-s SIG] [-c CLASS] [-i ID] [-n NAMES] [-o OUTPUT] FILE|DEVICE
+# Reads the trace messages from a capture file (or serial device node
+# configured with stty) until end of file or Ctrl+C and writes a JSON file
+# which can be opened with chrome://tracing or https://ui.perfetto.dev.
+# The optional NAMES file maps event ids to names and tracks, one event per
+# line: "ID NAME [TRACK]", i.e. "1 uart_rx isr".
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from telemetry import read_messages
+
+PHASES = {0x00: "i", 0x40: "B", 0x80: "E", 0xC0: "C"}
+
+
+def read_names(path):
+    """Returns {id: (name, track)} read from a names file"""
+    names = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.split("#", 1)[0].split()
+            if len(fields) >= 2:
+                names[int(fields[0], 0)] = (fields[1], fields[2] if len(fields) > 2 else "main")
+    return names
+
+
+def decode(payload):
+    """Returns (lost, [(id, arg, time_us)]) of a trace message. The 16-bit
+    event times are unwrapped backwards from the sending time."""
+    now, us_per_wrap, lost = struct.unpack_from("<IIH", payload, 0)
+    raw = [struct.unpack_from("<BBH", payload, pos) for pos in range(10, len(payload) - 3, 4)]
+    ticks = now
+    last = now & 0xFFFF
+    events = []
+    for ev_id, arg, time in reversed(raw):
+        ticks -= (last - time) & 0xFFFF
+        last = time
+        events.append((ev_id, arg, ticks * us_per_wrap / 65536.0))
+    events.reverse()
+    return lost, events
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert Axon event traces to Chrome trace JSON")
+    parser.add_argument("-s", "--sig", default="b562", help="message signature, as hex (default: b562)")
+    parser.add_argument("-c", "--cls", type=lambda x: int(x, 0), default=0xF0, help="message class (default: 0xF0)")
+    parser.add_argument("-i", "--id", type=lambda x: int(x, 0), default=0x02, help="message id (default: 0x02)")
+    parser.add_argument("-n", "--names", help="file mapping event ids to names and tracks")
+    parser.add_argument("-o", "--output", default="trace.json", help="output file (default: trace.json)")
+    parser.add_argument("input", help="capture file or device node")
+    args = parser.parse_args()
+
+    names = read_names(args.names) if args.names else {}
+    tracks = {}
+    trace = []
+    total_lost = 0
+    try:
+        with open(args.input, "rb", buffering=0) as stream:
+            for cls, mid, payload in read_messages(stream, bytes.fromhex(args.sig)):
+                if (cls, mid) != (args.cls, args.id) or len(payload) < 10:
+                    continue
+                lost, events = decode(payload)
+                total_lost += lost
+                for ev_id, arg, ts in events:
+                    name, track = names.get(ev_id & 0x3F, ("ev%d" % (ev_id & 0x3F), "main"))
+                    phase = PHASES[ev_id & 0xC0]
+                    event = {"name": name, "ph": phase, "ts": ts, "pid": 1,
+                             "tid": tracks.setdefault(track, len(tracks) + 1)}
+                    if phase == "C":
+                        event["args"] = {name: arg}
+                    else:
+                        event["args"] = {"arg": arg}
+                        if phase == "i":
+                            event["s"] = "t"
+                    trace.append(event)
+                if lost:
+                    trace.append({"name": "lost %d events" % lost, "ph": "i", "s": "g", "pid": 1, "tid": 0,
+                                  "ts": events[0][2] if events else (trace[-1]["ts"] if trace else 0)})
+    except KeyboardInterrupt:
+        pass
+
+    for track, tid in tracks.items():
+        trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid, "args": {"name": track}})
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": trace, "displayTimeUnit": "ns"}, f)
+    print("%d events written to %s, %d lost" % (len(trace) - len(tracks), args.output, total_lost))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())